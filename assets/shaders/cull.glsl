@@ -0,0 +1,87 @@
+#version 430
+
+layout(local_size_x = 64) in;
+
+layout(std430, binding = 0) readonly buffer position_buffer{
+  vec4 positions[];
+};
+
+// Level l holds its visible bodies from l * visible_stride.
+layout(std430, binding = 3) writeonly buffer visible_buffer{
+  uint visible[];
+};
+
+struct draw_command {
+  uint count;
+  uint instance_count;
+  uint first_index;
+  int base_vertex;
+  uint base_instance;
+};
+
+layout(std430, binding = 4) buffer command_buffer{
+  draw_command commands[];
+};
+
+const int lod_count = 3;
+// Drawn as ray traced quads, its command is laid out for glDrawArraysIndirect.
+const int impostor_level = lod_count;
+
+// One bit per body, set for the bodies drawn with a model of their own, their asteroid is skipped.
+layout(std430, binding = 5) readonly buffer modeled_buffer{
+  uint modeled[];
+};
+
+layout(std140, binding = 0) uniform camera {
+  mat4 view;
+  mat4 projection;
+  mat4 view_projection;
+};
+
+// Pixels per world unit at distance one.
+uniform float pixel_scale;
+uniform float radius;
+uniform float reference_mass;
+uniform int body_count;
+uniform int visible_stride;
+// Smaller bodies are not drawn.
+uniform float min_pixel_radius;
+// The smallest projected radius drawn with the finer levels.
+uniform float lod_pixel_radius[lod_count - 1];
+// Smaller bodies are drawn as impostors.
+uniform float impostor_pixel_radius;
+
+void main()
+{
+  int body = int(gl_GlobalInvocationID.x);
+  if (body >= body_count) return;
+  if ((modeled[body >> 5] & (1u << (body & 31))) != 0u) return;
+
+  vec4 p = vec4(positions[body].xyz, 1.0);
+  // Replays recorded without masses leave them zero, those bodies are drawn at the reference size.
+  float mass = positions[body].w > 0.0 ? positions[body].w : reference_mass;
+  float body_radius = radius * pow(mass / reference_mass, 1.0 / 3.0);
+  // Gribb and Hartmann: the frustum planes are sums and differences of the rows of view_projection.
+  mat4 rows = transpose(view_projection);
+  for (int i = 0; i < 3; ++i) {
+    vec4 lower = rows[3] + rows[i];
+    vec4 upper = rows[3] - rows[i];
+    if (dot(lower, p) < -body_radius * length(lower.xyz) || dot(upper, p) < -body_radius * length(upper.xyz)) {
+      return;
+    }
+  }
+
+  float depth = max(dot(rows[3], p), 1e-6);
+  float pixels = body_radius * pixel_scale / depth;
+  if (pixels < min_pixel_radius) return;
+
+  int lod = pixels < impostor_pixel_radius ? impostor_level : lod_count - 1;
+  for (int i = 0; i < lod_count - 1 && lod != impostor_level; ++i) {
+    if (pixels >= lod_pixel_radius[i]) {
+      lod = i;
+      break;
+    }
+  }
+  uint slot = atomicAdd(commands[lod].instance_count, 1u);
+  visible[lod * visible_stride + int(slot)] = uint(body);
+}
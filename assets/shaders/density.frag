@@ -0,0 +1,33 @@
+#version 430
+
+// Written by splat.glsl.
+uniform usampler2D density;
+uniform float exposure;
+uniform bool blur;
+
+out vec4 out_color;
+
+float log_density(ivec2 pixel)
+{
+    pixel = clamp(pixel, ivec2(0), textureSize(density, 0) - 1);
+    return log(1.0 + float(texelFetch(density, pixel, 0).r));
+}
+
+void main(void)
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float value = log_density(pixel);
+    if (blur) {
+        // 3x3 binomial filter.
+        value = 4.0 * value;
+        value += 2.0 * (log_density(pixel + ivec2(1, 0)) + log_density(pixel - ivec2(1, 0)) + log_density(pixel + ivec2(0, 1)) + log_density(pixel - ivec2(0, 1)));
+        value += log_density(pixel + ivec2(1, 1)) + log_density(pixel - ivec2(1, 1)) + log_density(pixel + ivec2(1, -1)) + log_density(pixel - ivec2(1, -1));
+        value /= 16.0;
+    }
+    if (value <= 0.0) {
+        discard;
+    }
+    // Reinhard on the log density, then a black body like ramp.
+    float intensity = value * exposure / (1.0 + value * exposure);
+    out_color = vec4(clamp(vec3(intensity * 3.0, intensity * 3.0 - 1.0, intensity * 3.0 - 2.0), 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,8 @@
+#version 430
+
+// One triangle over the whole screen, drawn without vertex data.
+void main(void)
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 4.0 - 1.0;
+    gl_Position = vec4(corner, 0.0, 1.0);
+}
@@ -12,15 +12,18 @@ layout(std430, binding = 1) buffer velocity_buffer{
 
 uniform float delta_time;
 uniform float gravity_constant;
+// The buffers have room for more bodies than they hold.
+uniform int body_count;
 
 
 void main()
 {
   int invocation_id = int(gl_GlobalInvocationID.x);
+  if (invocation_id >= body_count) return;
   vec3 my_pos = positions[invocation_id].xyz;
   vec3 my_velocity = vec3(0.0);
   // velocities[invocation_id] = vec4(my_pos, 0.0);
-  for (int i = 0; i < positions.length(); ++i) {
+  for (int i = 0; i < body_count; ++i) {
     if (i == invocation_id) continue;
     vec3 other_pos = positions[i].xyz;
     float other_mass = positions[i].w;
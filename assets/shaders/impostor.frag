@@ -0,0 +1,31 @@
+#version 430
+
+in vec3 frag_ray;
+flat in vec3 sphere_center;
+flat in float sphere_radius;
+flat in vec3 color;
+
+layout(std140, binding = 0) uniform camera {
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+};
+
+out vec4 out_color;
+
+void main(void)
+{
+    // Intersects the view ray through this fragment with the sphere, in view space.
+    vec3 direction = normalize(frag_ray);
+    float b = dot(direction, sphere_center);
+    float h = b * b - dot(sphere_center, sphere_center) + sphere_radius * sphere_radius;
+    if (h < 0.0) {
+        discard;
+    }
+    vec3 hit = direction * (b - sqrt(h));
+    vec3 normal = (hit - sphere_center) / sphere_radius;
+
+    vec4 clip = projection * vec4(hit, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+    out_color = vec4(color * mix(0.6, 1.0, max(-dot(normal, direction), 0.0)), 1);
+}
@@ -0,0 +1,39 @@
+#version 430
+
+layout(std430, binding = 0) readonly buffer position_buffer{
+  vec4 positions[];
+};
+
+// Written by cull.glsl.
+layout(std430, binding = 3) readonly buffer visible_buffer{
+  uint visible[];
+};
+
+layout(std140, binding = 0) uniform camera {
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+};
+
+uniform float radius;
+uniform float reference_mass;
+uniform int first_visible;
+
+out vec3 frag_ray;
+flat out vec3 sphere_center;
+flat out float sphere_radius;
+flat out vec3 color;
+
+void main(void)
+{
+    vec4 body = positions[visible[first_visible + gl_InstanceID]];
+    // Zero in replays recorded without masses.
+    float mass = body.w > 0.0 ? body.w : reference_mass;
+    sphere_radius = radius * pow(mass / reference_mass, 1.0 / 3.0);
+    sphere_center = (view * vec4(body.xyz, 1.0)).xyz;
+    // A triangle strip quad facing the camera in front of the sphere, which covers its silhouette.
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    frag_ray = sphere_center + vec3(corner * sphere_radius, sphere_radius);
+    gl_Position = projection * vec4(frag_ray, 1.0);
+    color = normalize(abs(normalize(body.xyz)));
+}
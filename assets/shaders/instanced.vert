@@ -4,15 +4,25 @@ layout(std430, binding = 0) buffer position_buffer{
   vec4 positions[];
 };
 
+// Written by cull.glsl.
+layout(std430, binding = 3) readonly buffer visible_buffer{
+  uint visible[];
+};
+
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 uv;
 
-struct Matrices {
-    mat4 vp;
+layout(std140, binding = 0) uniform camera {
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
 };
 
-uniform Matrices m;
+uniform float scale;
+// The mass drawn at scale, radii grow with the cube root of mass.
+uniform float reference_mass;
+uniform int first_visible;
 
 out vec3 frag_position;
 out vec3 frag_normal;
@@ -20,14 +30,17 @@ out vec2 frag_uv;
 
 void main(void)
 {
-    vec4 instance_position = positions[gl_InstanceID];
+    vec4 instance_position = positions[visible[first_visible + gl_InstanceID]];
     mat4 aMat4 = mat4(1.0, 0.0, 0.0, 0,  // 1. column
                       0.0, 1.0, 0.0, 0,  // 2. column
                       0.0, 0.0, 1.0, 0,  // 3. column
                       instance_position.x, instance_position.y, instance_position.z, 1.0);                  // 4. column
-	gl_Position = m.vp * aMat4 * vec4(position, 1.0);
+    // Zero in replays recorded without masses.
+    float mass = instance_position.w > 0.0 ? instance_position.w : reference_mass;
+    float body_scale = scale * pow(mass / reference_mass, 1.0 / 3.0);
+	gl_Position = view_projection * aMat4 * vec4(position * body_scale, 1.0);
     
-	frag_position = (aMat4 * vec4(position, 1.0)).xyz;
+	frag_position = (aMat4 * vec4(position * body_scale, 1.0)).xyz;
     frag_position = vec3(normalize(instance_position.xyz));
     frag_normal = normalize(mat3(aMat4) * normal);
     frag_uv = uv;
@@ -0,0 +1,43 @@
+#version 430
+
+layout(std430, binding = 0) readonly buffer position_buffer{
+  vec4 positions[];
+};
+
+struct model_instance {
+    vec4 position_scale;
+    // x is the body slot to follow, -1 to stay at position_scale.xyz.
+    ivec4 body;
+};
+
+layout(std430, binding = 2) readonly buffer instance_buffer{
+  model_instance instances[];
+};
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 uv;
+
+layout(std140, binding = 0) uniform camera {
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+};
+
+uniform int first_instance;
+
+out vec3 frag_position;
+out vec3 frag_normal;
+out vec2 frag_uv;
+
+void main(void)
+{
+    model_instance instance = instances[first_instance + gl_InstanceID];
+    int slot = instance.body.x;
+    vec3 center = slot < 0 ? instance.position_scale.xyz : positions[slot].xyz;
+	gl_Position = view_projection * vec4(center + position * instance.position_scale.w, 1.0);
+
+    frag_position = vec3(0.9059, 0.8196, 0.0627);
+    frag_normal = normal;
+    frag_uv = uv;
+}
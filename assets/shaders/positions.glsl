@@ -12,10 +12,12 @@ layout(std430, binding = 1) buffer velocity_buffer{
 
 uniform float delta_time;
 uniform float gravity_constant;
+uniform int body_count;
 
 
 void main()
 {
   int invocation_id = int(gl_GlobalInvocationID.x);
+  if (invocation_id >= body_count) return;
   positions[invocation_id].xyz += vec3(velocities[invocation_id]) * delta_time;
 }
\ No newline at end of file
@@ -0,0 +1,31 @@
+#version 430
+
+layout(local_size_x = 64) in;
+
+layout(std430, binding = 0) readonly buffer position_buffer{
+  vec4 positions[];
+};
+
+// Bodies per pixel, cleared every frame.
+layout(r32ui, binding = 0) uniform uimage2D density;
+
+layout(std140, binding = 0) uniform camera {
+  mat4 view;
+  mat4 projection;
+  mat4 view_projection;
+};
+
+uniform int body_count;
+
+void main()
+{
+  int body = int(gl_GlobalInvocationID.x);
+  if (body >= body_count) return;
+
+  vec4 clip = view_projection * vec4(positions[body].xyz, 1.0);
+  if (clip.w <= 0.0) return;
+  vec2 ndc = clip.xy / clip.w;
+  if (any(greaterThanEqual(abs(ndc), vec2(1.0)))) return;
+  ivec2 pixel = ivec2((ndc * 0.5 + 0.5) * vec2(imageSize(density)));
+  imageAtomicAdd(density, pixel, 1u);
+}
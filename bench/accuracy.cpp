@@ -0,0 +1,353 @@
+#include "components.h"
+#include "gravity_system.h"
+#include "particles.h"
+#include "spawn.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fmt/core.h>
+#include <functional>
+#include <glm/glm.hpp>
+#include <glm/gtx/norm.hpp>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Runs a seeded scenario through every candidate solver and compares it against an O(N^2)
+// reference in double precision. Candidates that are not beaten on wall time, force error
+// and energy drift at the same time form the Pareto front.
+
+namespace {
+
+using namespace gravity;
+
+constexpr float gravity_constant{10.f};
+// Same cutoff as gravity_system, pairs closer than this do not interact.
+constexpr double min_distance2{0.01};
+
+struct options {
+	std::string scenario{"asteroids"};
+	size_t bodies{1000};
+	uint64_t seed{1337};
+	size_t steps{256};
+	float delta_time{1.f / 144.f};
+	size_t samples{16};
+	std::string series_path{};
+};
+
+using step_function = auto (*)(entt::registry&, float) -> void;
+
+struct candidate {
+	char const* name;
+	// Steps with timestep_multiplier * delta_time, the simulated time is the same for every candidate.
+	size_t timestep_multiplier;
+	step_function step;
+};
+
+struct body_state {
+	std::vector<glm::dvec3> positions{};
+	std::vector<glm::dvec3> velocities{};
+	std::vector<double> masses{};
+};
+
+struct drift_sample {
+	double time;
+	double energy;
+	double momentum;
+};
+
+struct result {
+	std::string name{};
+	double delta_time{};
+	double wall_seconds{};
+	std::array<double, 4> force_error{}; // p50, p90, p99, max
+	double max_energy_drift{};
+	double final_energy_drift{};
+	double max_momentum_drift{};
+	std::vector<drift_sample> series{};
+	bool pareto{};
+};
+
+auto read_state(entt::registry const& registry) -> body_state {
+	auto state{body_state{}};
+	auto view = registry.view<const transform_component, const physics_component>();
+	for (auto [entity, transform, physics] : view.each()) {
+		state.positions.emplace_back(transform.position);
+		state.velocities.emplace_back(physics.velocity);
+		state.masses.push_back(physics.mass);
+	}
+	return state;
+}
+
+auto reference_accelerations(body_state const& state) -> std::vector<glm::dvec3> {
+	auto accelerations{std::vector<glm::dvec3>(state.positions.size(), glm::dvec3{0.0})};
+	for (size_t i{0}; i < state.positions.size(); ++i) {
+		for (size_t j{0}; j < state.positions.size(); ++j) {
+			auto const offset{state.positions[j] - state.positions[i]};
+			auto const distance2{glm::length2(offset)};
+			if (i == j || distance2 < min_distance2) {
+				continue;
+			}
+			accelerations[i] += gravity_constant * state.masses[j] / distance2 * glm::normalize(offset);
+		}
+	}
+	return accelerations;
+}
+
+auto total_energy(body_state const& state) -> double {
+	auto energy{0.0};
+	for (size_t i{0}; i < state.positions.size(); ++i) {
+		energy += 0.5 * state.masses[i] * glm::length2(state.velocities[i]);
+		for (size_t j{i + 1}; j < state.positions.size(); ++j) {
+			auto const distance2{glm::distance2(state.positions[i], state.positions[j])};
+			if (distance2 >= min_distance2) {
+				energy -= gravity_constant * state.masses[i] * state.masses[j] / std::sqrt(distance2);
+			}
+		}
+	}
+	return energy;
+}
+
+auto total_momentum(body_state const& state) -> glm::dvec3 {
+	auto momentum{glm::dvec3{0.0}};
+	for (size_t i{0}; i < state.positions.size(); ++i) {
+		momentum += state.masses[i] * state.velocities[i];
+	}
+	return momentum;
+}
+
+// The total momentum of a bound system is close to zero, drift is relative to the summed |p| instead.
+auto momentum_scale(body_state const& state) -> double {
+	auto scale{0.0};
+	for (size_t i{0}; i < state.positions.size(); ++i) {
+		scale += state.masses[i] * glm::length(state.velocities[i]);
+	}
+	return scale;
+}
+
+auto build_scenario(entt::registry& registry, options const& opts) -> bool {
+	auto packed{particle_buffers{}};
+	registry.set<gravity_system::gravity_constant>(gravity_constant);
+	if (opts.scenario == "moon") {
+		spawn::moon_system(registry);
+		return true;
+	}
+	if (opts.scenario == "asteroids") {
+		spawn::asteroids(registry, spawn::asteroid_belt{.amount = std::max(opts.bodies, size_t{2}) - 1, .seed = opts.seed}, packed);
+		return true;
+	}
+	constexpr auto galaxies{std::array<std::pair<std::string_view, spawn::galaxy_model>, 3>{{
+		{"plummer", spawn::galaxy_model::plummer},
+		{"hernquist", spawn::galaxy_model::hernquist},
+		{"disk", spawn::galaxy_model::exponential_disk},
+	}}};
+	for (auto const& [name, model] : galaxies) {
+		if (opts.scenario == name) {
+			spawn::galaxy_bodies(registry, spawn::galaxy{.model = model, .amount = opts.bodies, .seed = opts.seed}, packed);
+			return true;
+		}
+	}
+	return false;
+}
+
+auto percentile(std::vector<double>& values, double fraction) -> double {
+	if (values.empty()) {
+		return 0.0;
+	}
+	auto const index{static_cast<size_t>(fraction * static_cast<double>(values.size() - 1))};
+	std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+	return values[index];
+}
+
+auto run(candidate const& solver, options const& opts) -> result {
+	auto registry{entt::registry{}};
+	build_scenario(registry, opts);
+
+	auto const delta_time{opts.delta_time * static_cast<float>(solver.timestep_multiplier)};
+	auto const steps{std::max(opts.steps / solver.timestep_multiplier, size_t{1})};
+	auto const sample_interval{std::max(steps / std::max(opts.samples, size_t{1}), size_t{1})};
+
+	auto const initial{read_state(registry)};
+	auto const initial_energy{total_energy(initial)};
+	auto const initial_momentum{total_momentum(initial)};
+	auto const scale{momentum_scale(initial)};
+
+	auto out{result{.name = solver.name, .delta_time = delta_time}};
+	auto errors{std::vector<double>{}};
+	auto wall{std::chrono::steady_clock::duration{0}};
+
+	for (size_t step{0}; step < steps; ++step) {
+		auto const sampled{step % sample_interval == 0};
+		auto before{body_state{}};
+		auto reference{std::vector<glm::dvec3>{}};
+		if (sampled) {
+			before = read_state(registry);
+			reference = reference_accelerations(before);
+		}
+
+		auto const start{std::chrono::steady_clock::now()};
+		solver.step(registry, delta_time);
+		wall += std::chrono::steady_clock::now() - start;
+
+		if (!sampled) {
+			continue;
+		}
+		// The kick uses the positions from before the drift, so the velocity change is the candidate's force.
+		auto const after{read_state(registry)};
+		for (size_t i{0}; i < reference.size(); ++i) {
+			auto const reference_length{glm::length(reference[i])};
+			if (reference_length > 0.0) {
+				auto const acceleration{(after.velocities[i] - before.velocities[i]) / static_cast<double>(delta_time)};
+				errors.push_back(glm::length(acceleration - reference[i]) / reference_length);
+			}
+		}
+		// Relative to the initial energy, or absolute when that is zero.
+		auto const energy_change{total_energy(after) - initial_energy};
+		auto const energy_drift{std::abs(initial_energy == 0.0 ? energy_change : energy_change / initial_energy)};
+		auto const momentum_drift{scale == 0.0 ? 0.0 : glm::length(total_momentum(after) - initial_momentum) / scale};
+		out.series.push_back(drift_sample{static_cast<double>(step + 1) * delta_time, energy_drift, momentum_drift});
+		out.max_energy_drift = std::max(out.max_energy_drift, energy_drift);
+		out.max_momentum_drift = std::max(out.max_momentum_drift, momentum_drift);
+		out.final_energy_drift = energy_drift;
+	}
+
+	out.wall_seconds = std::chrono::duration<double>(wall).count();
+	out.force_error = {percentile(errors, 0.5), percentile(errors, 0.9), percentile(errors, 0.99), percentile(errors, 1.0)};
+	return out;
+}
+
+auto mark_pareto_front(std::span<result> results) -> void {
+	auto const objectives = [](result const& r) {
+		return std::array{r.wall_seconds, r.force_error[2], r.max_energy_drift};
+	};
+	for (auto& r : results) {
+		auto const mine{objectives(r)};
+		r.pareto = std::ranges::none_of(results, [&](result const& other) {
+			auto const theirs{objectives(other)};
+			auto const no_worse{std::ranges::equal(theirs, mine, std::less_equal{})};
+			return no_worse && theirs != mine;
+		});
+	}
+}
+
+auto print_table(std::span<result const> results, options const& opts) -> void {
+	fmt::print("Scenario {} with {} bodies, seed {}, {:.4f} simulated seconds\n", opts.scenario, opts.bodies, opts.seed, opts.delta_time * static_cast<float>(opts.steps));
+	fmt::print("{:<24} {:>9} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>7}\n",
+		"Solver", "dt", "Wall s", "Err p50", "Err p90", "Err p99", "Err max", "dE max", "dE final", "dP max", "Pareto");
+	for (auto const& r : results) {
+		fmt::print("{:<24} {:>9.5f} {:>10.4f} {:>10.2e} {:>10.2e} {:>10.2e} {:>10.2e} {:>10.2e} {:>10.2e} {:>10.2e} {:>7}\n",
+			r.name, r.delta_time, r.wall_seconds,
+			r.force_error[0], r.force_error[1], r.force_error[2], r.force_error[3],
+			r.max_energy_drift, r.final_energy_drift, r.max_momentum_drift,
+			r.pareto ? "*" : "");
+	}
+}
+
+auto write_series(std::span<result const> results, std::string const& path) -> bool {
+	auto* file{std::fopen(path.c_str(), "w")};
+	if (file == nullptr) {
+		return false;
+	}
+	fmt::print(file, "solver,dt,time,energy_drift,momentum_drift\n");
+	for (auto const& r : results) {
+		for (auto const& sample : r.series) {
+			fmt::print(file, "{},{},{},{},{}\n", r.name, r.delta_time, sample.time, sample.energy, sample.momentum);
+		}
+	}
+	std::fclose(file);
+	return true;
+}
+
+// Throws std::invalid_argument naming flag if value is not a T.
+template <typename T>
+auto parse_number(std::string_view flag, std::string_view value) -> T {
+	auto parsed{T{}};
+	auto const [end, error]{std::from_chars(value.data(), value.data() + value.size(), parsed)};
+	if (error != std::errc{} || end != value.data() + value.size()) {
+		throw std::invalid_argument{fmt::format("{} expects a number, got '{}'", flag, value)};
+	}
+	return parsed;
+}
+
+auto parse_options(std::span<char*> args, options& opts) -> bool {
+	try {
+		for (size_t i{1}; i < args.size(); ++i) {
+			auto const arg{std::string_view{args[i]}};
+			if (i + 1 >= args.size()) {
+				fmt::print(stderr, "Missing value for {}\n", arg);
+				return false;
+			}
+			auto const value{std::string_view{args[++i]}};
+			if (arg == "--scenario") {
+				opts.scenario = value;
+			} else if (arg == "--bodies") {
+				opts.bodies = parse_number<size_t>(arg, value);
+			} else if (arg == "--seed") {
+				opts.seed = parse_number<uint64_t>(arg, value);
+			} else if (arg == "--steps") {
+				opts.steps = parse_number<size_t>(arg, value);
+			} else if (arg == "--dt") {
+				opts.delta_time = parse_number<float>(arg, value);
+				if (!std::isfinite(opts.delta_time) || opts.delta_time <= 0.f) {
+					throw std::invalid_argument{fmt::format("{} expects a positive time step, got '{}'", arg, value)};
+				}
+			} else if (arg == "--samples") {
+				opts.samples = parse_number<size_t>(arg, value);
+			} else if (arg == "--series") {
+				opts.series_path = value;
+			} else {
+				fmt::print(stderr, "Unknown option {}\n", arg);
+				return false;
+			}
+		}
+	} catch (std::invalid_argument const& error) {
+		fmt::print(stderr, "{}\n", error.what());
+		return false;
+	}
+	return true;
+}
+
+} // namespace
+
+auto main(int argc, char* argv[]) -> int {
+	auto opts{options{}};
+	if (!parse_options(std::span{argv, static_cast<size_t>(argc)}, opts)) {
+		fmt::print(stderr, "Usage: gravity_accuracy [--scenario asteroids|moon|plummer|hernquist|disk] [--bodies N] [--seed S] [--steps K] [--dt DT] [--samples M] [--series file.csv]\n");
+		return 1;
+	}
+	if (auto registry{entt::registry{}}; build_scenario(registry, opts)) {
+		opts.bodies = registry.view<physics_component>().size();
+	} else {
+		fmt::print(stderr, "Unknown scenario {}\n", opts.scenario);
+		return 1;
+	}
+
+	// New solvers are added here, the reference is always the double precision brute force.
+	auto const candidates{std::array{
+		candidate{"CPU brute force", 1, gravity_system::update},
+		candidate{"CPU brute force 2dt", 2, gravity_system::update},
+		candidate{"CPU brute force 4dt", 4, gravity_system::update},
+	}};
+
+	auto results{std::vector<result>{}};
+	for (auto const& solver : candidates) {
+		fmt::print(stderr, "Running {}...\n", solver.name);
+		results.push_back(run(solver, opts));
+	}
+	mark_pareto_front(results);
+	print_table(results, opts);
+
+	if (!opts.series_path.empty() && !write_series(results, opts.series_path)) {
+		fmt::print(stderr, "Could not write {}\n", opts.series_path);
+		return 1;
+	}
+	return 0;
+}
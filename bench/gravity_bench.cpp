@@ -0,0 +1,138 @@
+#include "components.h"
+#include "gravity_system.h"
+#include "particles.h"
+#include "shape.h"
+#include "spawn.h"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace gravity;
+
+constexpr uint64_t seed{1337};
+constexpr float delta_time{1.f / 144.f};
+constexpr float gravity_constant{10.f};
+
+constexpr int64_t min_bodies{100};
+constexpr int64_t max_bodies{10'000'000};
+// The brute force kernels are O(N^2), 10^5 bodies is already 10^10 interactions per iteration.
+constexpr int64_t max_quadratic_bodies{10'000};
+
+// Planet plus asteroids, the same scenario as the Spawn Asteroids button.
+auto populate(entt::registry& registry, int64_t bodies) -> void {
+	registry.set<gravity_system::gravity_constant>(gravity_constant);
+	auto packed{particle_buffers{}};
+	spawn::asteroids(registry, spawn::asteroid_belt{.amount = static_cast<size_t>(bodies - 1), .seed = seed}, packed);
+}
+
+auto set_body_counters(benchmark::State& state, int64_t bodies) -> void {
+	state.counters["bodies"] = static_cast<double>(bodies);
+	state.counters["bodies/s"] = benchmark::Counter(static_cast<double>(bodies), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+auto set_interaction_counters(benchmark::State& state, int64_t bodies) -> void {
+	state.counters["bodies"] = static_cast<double>(bodies);
+	state.counters["interactions/s"] = benchmark::Counter(static_cast<double>(bodies * (bodies - 1)), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+auto bm_gravity_update(benchmark::State& state) -> void {
+	auto registry{entt::registry{}};
+	populate(registry, state.range(0));
+	for (auto _ : state) {
+		gravity_system::update(registry, delta_time);
+	}
+	set_interaction_counters(state, state.range(0));
+}
+
+auto bm_accumulate_forces(benchmark::State& state) -> void {
+	auto registry{entt::registry{}};
+	populate(registry, state.range(0));
+	for (auto _ : state) {
+		gravity_system::accumulate_forces(registry, delta_time);
+	}
+	set_interaction_counters(state, state.range(0));
+}
+
+auto bm_integrate(benchmark::State& state) -> void {
+	auto registry{entt::registry{}};
+	populate(registry, state.range(0));
+	for (auto _ : state) {
+		gravity_system::integrate(registry, delta_time);
+	}
+	set_body_counters(state, state.range(0));
+}
+
+auto bm_spawn_asteroids(benchmark::State& state) -> void {
+	auto registry{entt::registry{}};
+	registry.set<gravity_system::gravity_constant>(gravity_constant);
+	auto const belt{spawn::asteroid_belt{.amount = static_cast<size_t>(state.range(0) - 1), .seed = seed}};
+	auto packed{particle_buffers{}};
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(spawn::asteroids(registry, belt, packed));
+	}
+	set_body_counters(state, state.range(0));
+}
+
+auto bm_pack_particles(benchmark::State& state) -> void {
+	auto registry{entt::registry{}};
+	populate(registry, state.range(0));
+	auto buffers{particle_buffers{}};
+	for (auto _ : state) {
+		pack_particles(registry, buffers);
+		benchmark::DoNotOptimize(buffers.positions.data());
+		benchmark::DoNotOptimize(buffers.velocities.data());
+		benchmark::ClobberMemory();
+	}
+	set_body_counters(state, state.range(0));
+	state.SetBytesProcessed(state.iterations() * state.range(0) * 2 * static_cast<int64_t>(sizeof(glm::vec4)));
+}
+
+// N is about the vertex count of the sphere, the CPU side of shape::create_sphere without the cache.
+auto bm_sphere_mesh(benchmark::State& state) -> void {
+	auto const resolution{std::max(2u, static_cast<unsigned int>(std::lround(std::sqrt(static_cast<double>(state.range(0)) / 6.0))))};
+	for (auto _ : state) {
+		auto sphere{shape::build_sphere(resolution)};
+		benchmark::DoNotOptimize(sphere.vertices.data());
+	}
+	auto const vertices{static_cast<int64_t>(shape::build_sphere(resolution).vertices.size())};
+	state.counters["resolution"] = resolution;
+	state.counters["vertices"] = static_cast<double>(vertices);
+	state.counters["vertices/s"] = benchmark::Counter(static_cast<double>(vertices), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+} // namespace
+
+BENCHMARK(bm_gravity_update)->RangeMultiplier(10)->Range(min_bodies, max_quadratic_bodies)->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_accumulate_forces)->RangeMultiplier(10)->Range(min_bodies, max_quadratic_bodies)->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_integrate)->RangeMultiplier(10)->Range(min_bodies, max_bodies)->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_spawn_asteroids)->RangeMultiplier(10)->Range(min_bodies, max_bodies)->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_pack_particles)->RangeMultiplier(10)->Range(min_bodies, max_bodies)->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_sphere_mesh)->RangeMultiplier(10)->Range(min_bodies, max_bodies)->Unit(benchmark::kMillisecond);
+
+auto main(int argc, char** argv) -> int {
+	// JSON unless another format is asked for, so release runs can be compared by scripts.
+	auto arguments{std::vector<char*>{argv, argv + argc}};
+	auto json_format{std::string{"--benchmark_format=json"}};
+	auto const has_format{std::ranges::any_of(std::span{argv, static_cast<size_t>(argc)}, [](char const* argument) {
+		return std::string_view{argument}.starts_with("--benchmark_format");
+	})};
+	if (!has_format) {
+		arguments.push_back(json_format.data());
+	}
+	auto count{static_cast<int>(arguments.size())};
+	benchmark::Initialize(&count, arguments.data());
+	if (benchmark::ReportUnrecognizedArguments(count, arguments.data())) {
+		return 1;
+	}
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
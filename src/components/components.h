@@ -18,7 +18,8 @@ struct physics_component {
 };
 
 struct renderable {
-	model model;
+	shared_model model;
+	float scale{1.f};
 };
 
 struct sphere_component {
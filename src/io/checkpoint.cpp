@@ -0,0 +1,248 @@
+#include "checkpoint.h"
+
+#include "components.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <fmt/core.h>
+#include <stdexcept>
+#include <trace.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gravity::io {
+
+static_assert(std::endian::native == std::endian::little, "Checkpoints are stored little endian");
+
+namespace {
+
+constexpr uint64_t array_alignment{64};
+
+// Links a snapshot entity to its index in the particle arrays.
+struct checkpoint_slot {
+	uint64_t index;
+};
+
+auto align(uint64_t offset) -> uint64_t {
+	return (offset + array_alignment - 1) / array_alignment * array_alignment;
+}
+
+class output_archive {
+public:
+	template <typename... Values>
+	auto operator()(Values const&... values) -> void {
+		(write(values), ...);
+	}
+
+	std::vector<std::byte> bytes{};
+
+private:
+	template <typename T>
+	auto write(T const& value) -> void {
+		static_assert(std::is_trivially_copyable_v<T>);
+		auto const* first{reinterpret_cast<std::byte const*>(&value)};
+		bytes.insert(bytes.end(), first, first + sizeof(T));
+	}
+};
+
+class input_archive {
+public:
+	explicit input_archive(std::span<std::byte const> bytes)
+		: bytes{bytes} {}
+
+	template <typename... Values>
+	auto operator()(Values&... values) -> void {
+		(read(values), ...);
+	}
+
+private:
+	template <typename T>
+	auto read(T& value) -> void {
+		static_assert(std::is_trivially_copyable_v<T>);
+		if (offset + sizeof(T) > bytes.size()) {
+			throw std::runtime_error{"Checkpoint registry snapshot is truncated"};
+		}
+		std::memcpy(&value, bytes.data() + offset, sizeof(T));
+		offset += sizeof(T);
+	}
+
+	std::span<std::byte const> bytes;
+	size_t offset{0};
+};
+
+class file_writer {
+public:
+	explicit file_writer(std::filesystem::path const& path)
+		: path{path}
+		, file{std::fopen(path.string().c_str(), "wb")} {
+		if (file == nullptr) {
+			throw std::runtime_error{fmt::format("Failed to open {} for writing", path.string())};
+		}
+	}
+	~file_writer() {
+		if (file != nullptr) {
+			std::fclose(file);
+		}
+	}
+	file_writer(file_writer const&) = delete;
+	auto operator=(file_writer const&) -> file_writer& = delete;
+	file_writer(file_writer&&) = delete;
+	auto operator=(file_writer&&) -> file_writer& = delete;
+
+	// Sections are written front to back, the gaps up to offset are zero filled.
+	auto write_at(uint64_t offset, void const* data, size_t size) -> void {
+		constexpr auto zeros{std::array<char, array_alignment>{}};
+		while (position < offset) {
+			auto const padding{std::min<uint64_t>(offset - position, zeros.size())};
+			write(zeros.data(), padding);
+		}
+		write(data, size);
+	}
+
+	auto close() -> void {
+		auto const result{std::fclose(std::exchange(file, nullptr))};
+		if (result != 0) {
+			throw std::runtime_error{fmt::format("Failed to write {}", path.string())};
+		}
+	}
+
+private:
+	auto write(void const* data, size_t size) -> void {
+		if (std::fwrite(data, 1, size, file) != size) {
+			throw std::runtime_error{fmt::format("Failed to write {}", path.string())};
+		}
+		position += size;
+	}
+
+	std::filesystem::path path;
+	std::FILE* file;
+	uint64_t position{0};
+};
+
+} // namespace
+
+auto save_checkpoint(std::filesystem::path const& path, entt::registry& registry, particle_buffers const& particles, simulation_state const& state) -> void {
+	TRACE_FUNCTION();
+	// Bodies that are more than a particle go through an entt snapshot of a scratch registry,
+	// so the file does not grow with the number of asteroids.
+	auto extras{entt::registry{}};
+	uint64_t slot{0};
+	for (auto const entity : particle_entities(registry)) {
+		if (!registry.all_of<instanced_component>(entity)) {
+			auto const extra{extras.create()};
+			extras.emplace<checkpoint_slot>(extra, slot);
+			if (auto const* sphere{registry.try_get<sphere_component>(entity)}; sphere != nullptr) {
+				extras.emplace<sphere_component>(extra, *sphere);
+			}
+		}
+		++slot;
+	}
+	if (slot != particles.size()) {
+		throw std::runtime_error{"Particle buffers were not packed from this registry"};
+	}
+	auto archive{output_archive{}};
+	entt::snapshot{extras}.entities(archive).component<checkpoint_slot, sphere_component>(archive);
+
+	auto const body_bytes{particles.size() * sizeof(glm::vec4)};
+	auto header{checkpoint_header{
+		.magic = checkpoint_magic,
+		.version = checkpoint_version,
+		.header_size = sizeof(checkpoint_header),
+		.body_count = particles.size(),
+		.time = state.time,
+		.tick_count = state.tick_count,
+		.gravity_constant = state.gravity_constant,
+		.rng_size = static_cast<uint32_t>(state.rng_state.size()),
+		.rng_offset = sizeof(checkpoint_header),
+		.positions_offset = 0,
+		.velocities_offset = 0,
+		.registry_offset = 0,
+		.registry_size = archive.bytes.size(),
+	}};
+	header.positions_offset = align(header.rng_offset + header.rng_size);
+	header.velocities_offset = align(header.positions_offset + body_bytes);
+	header.registry_offset = align(header.velocities_offset + body_bytes);
+
+	auto writer{file_writer{path}};
+	writer.write_at(0, &header, sizeof(header));
+	writer.write_at(header.rng_offset, state.rng_state.data(), state.rng_state.size());
+	writer.write_at(header.positions_offset, particles.positions.data(), body_bytes);
+	writer.write_at(header.velocities_offset, particles.velocities.data(), body_bytes);
+	writer.write_at(header.registry_offset, archive.bytes.data(), archive.bytes.size());
+	writer.close();
+}
+
+checkpoint::checkpoint(std::filesystem::path const& path)
+	: file{path} {
+	auto const bytes{file.bytes()};
+	if (bytes.size() < sizeof(checkpoint_header)) {
+		throw std::runtime_error{fmt::format("{} is not a checkpoint", path.string())};
+	}
+	std::memcpy(&header, bytes.data(), sizeof(checkpoint_header));
+	if (header.magic != checkpoint_magic) {
+		throw std::runtime_error{fmt::format("{} is not a checkpoint", path.string())};
+	}
+	if (header.version != checkpoint_version || header.header_size != sizeof(checkpoint_header)) {
+		throw std::runtime_error{fmt::format("{} is checkpoint version {}, expected {}", path.string(), header.version, checkpoint_version)};
+	}
+	if (header.body_count > bytes.size() / sizeof(glm::vec4)) {
+		throw std::runtime_error{fmt::format("{} is truncated", path.string())};
+	}
+	auto const body_bytes{header.body_count * sizeof(glm::vec4)};
+	auto const fits = [&](uint64_t offset, uint64_t size) { return offset <= bytes.size() && size <= bytes.size() - offset; };
+	if (!fits(header.rng_offset, header.rng_size) || !fits(header.positions_offset, body_bytes) || !fits(header.velocities_offset, body_bytes)
+		|| !fits(header.registry_offset, header.registry_size)) {
+		throw std::runtime_error{fmt::format("{} is truncated", path.string())};
+	}
+	if (header.positions_offset % alignof(glm::vec4) != 0 || header.velocities_offset % alignof(glm::vec4) != 0) {
+		throw std::runtime_error{fmt::format("{} has misaligned body arrays", path.string())};
+	}
+	file.advise_sequential();
+}
+
+auto checkpoint::state() const -> simulation_state {
+	auto const rng{file.bytes().subspan(header.rng_offset, header.rng_size)};
+	return simulation_state{
+		.gravity_constant = header.gravity_constant,
+		.time = header.time,
+		.tick_count = header.tick_count,
+		.rng_state = std::string{reinterpret_cast<char const*>(rng.data()), rng.size()},
+	};
+}
+
+auto checkpoint::positions() const -> std::span<glm::vec4 const> {
+	return {reinterpret_cast<glm::vec4 const*>(file.bytes().data() + header.positions_offset), header.body_count};
+}
+
+auto checkpoint::velocities() const -> std::span<glm::vec4 const> {
+	return {reinterpret_cast<glm::vec4 const*>(file.bytes().data() + header.velocities_offset), header.body_count};
+}
+
+auto checkpoint::restore(entt::registry& registry) const -> void {
+	TRACE_FUNCTION();
+	// Read and checked in full before the registry is cleared.
+	auto extras{entt::registry{}};
+	auto archive{input_archive{file.bytes().subspan(header.registry_offset, header.registry_size)}};
+	entt::snapshot_loader{extras}.entities(archive).component<checkpoint_slot, sphere_component>(archive).orphans();
+	for (auto [extra, slot] : extras.view<const checkpoint_slot>().each()) {
+		if (slot.index >= header.body_count) {
+			throw std::runtime_error{fmt::format("Checkpoint body slot {} is out of range", slot.index)};
+		}
+	}
+
+	registry.clear();
+	auto const entities{create_particles(registry, positions(), velocities())};
+	for (auto [extra, slot] : extras.view<const checkpoint_slot>().each()) {
+		auto const entity{entities[slot.index]};
+		registry.remove<instanced_component>(entity);
+		if (auto const* sphere{extras.try_get<sphere_component>(extra)}; sphere != nullptr) {
+			registry.emplace<sphere_component>(entity, *sphere);
+		}
+	}
+}
+
+} // namespace gravity::io
@@ -0,0 +1,76 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "mapped_file.h"
+#include "particles.h"
+
+#include <array>
+#include <cstdint>
+#include <entt/entt.hpp>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <span>
+#include <string>
+
+namespace gravity::io {
+
+// Layout of a checkpoint, all offsets are from the start of the file and the
+// particle arrays are 64 byte aligned so they can be uploaded from the mapping as is.
+//
+//   checkpoint_header
+//   RNG state       rng_size bytes, as written by operator<< of the engine
+//   positions       body_count * vec4, std430 with the mass in w
+//   velocities      body_count * vec4
+//   registry        entt snapshot of the bodies that are not plain particles
+struct checkpoint_header {
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t header_size;
+	uint64_t body_count;
+	double time;
+	uint64_t tick_count;
+	float gravity_constant;
+	uint32_t rng_size;
+	uint64_t rng_offset;
+	uint64_t positions_offset;
+	uint64_t velocities_offset;
+	uint64_t registry_offset;
+	uint64_t registry_size;
+};
+
+constexpr auto checkpoint_magic{std::array<char, 8>{'G', 'R', 'A', 'V', 'C', 'K', 'P', 'T'}};
+constexpr uint32_t checkpoint_version{1};
+
+struct simulation_state {
+	float gravity_constant{};
+	double time{};
+	uint64_t tick_count{};
+	std::string rng_state{};
+};
+
+// particles must be packed from registry with pack_particles, bodies without instanced_component
+// are matched to their slot and stored with their sphere_component. Throws std::runtime_error.
+auto save_checkpoint(std::filesystem::path const& path, entt::registry& registry, particle_buffers const& particles, simulation_state const& state) -> void;
+
+// A mapped checkpoint, the particle arrays point into the mapping.
+class checkpoint {
+public:
+	// Throws std::runtime_error if the file is not a checkpoint of this version.
+	explicit checkpoint(std::filesystem::path const& path);
+
+	[[nodiscard]] auto state() const -> simulation_state;
+	[[nodiscard]] auto positions() const -> std::span<glm::vec4 const>;
+	[[nodiscard]] auto velocities() const -> std::span<glm::vec4 const>;
+
+	// Replaces the bodies in registry, particles are created in bulk. Renderables are left to the caller.
+	// Throws std::runtime_error on a corrupt snapshot, before registry is changed.
+	auto restore(entt::registry& registry) const -> void;
+
+private:
+	mapped_file file;
+	checkpoint_header header{};
+};
+
+} // namespace gravity::io
+
+#endif
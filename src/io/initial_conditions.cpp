@@ -0,0 +1,260 @@
+#include "initial_conditions.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fmt/core.h>
+#include <optional>
+#include <parallel.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <trace.h>
+#include <vector>
+
+namespace gravity::io {
+
+static_assert(std::endian::native == std::endian::little, "Body files are stored little endian");
+
+namespace {
+
+constexpr uint64_t array_alignment{64};
+// Bytes of CSV per parallel task.
+constexpr size_t csv_chunk_size{size_t{4} << 20};
+
+enum column : int {
+	x, y, z, vx, vy, vz, mass, column_count,
+	ignored = -1,
+};
+
+auto align(uint64_t offset) -> uint64_t {
+	return (offset + array_alignment - 1) / array_alignment * array_alignment;
+}
+
+auto is_separator(char c) -> bool {
+	return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\r';
+}
+
+auto is_data_line(std::string_view line) -> bool {
+	auto const first{line.find_first_not_of(" \t\r")};
+	return first != std::string_view::npos && line[first] != '#';
+}
+
+auto next_line(std::string_view text, size_t& offset) -> std::string_view {
+	auto const end{std::min(text.find('\n', offset), text.size())};
+	auto const line{text.substr(offset, end - offset)};
+	offset = end + 1;
+	return line;
+}
+
+// Calls field(index, text) for each field of line, stops early and returns false if field does.
+template <typename Field>
+auto split_fields(std::string_view line, Field&& field) -> bool {
+	size_t index{0};
+	size_t offset{0};
+	while (offset < line.size()) {
+		while (offset < line.size() && is_separator(line[offset])) {
+			++offset;
+		}
+		if (offset == line.size()) {
+			break;
+		}
+		auto const start{offset};
+		while (offset < line.size() && !is_separator(line[offset])) {
+			++offset;
+		}
+		if (!field(index++, line.substr(start, offset - start))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+auto parse_float(std::string_view text) -> std::optional<float> {
+	if (!text.empty() && text.front() == '+') {
+		text.remove_prefix(1);
+	}
+	float value;
+	auto const [end, error]{std::from_chars(text.data(), text.data() + text.size(), value)};
+	if (error != std::errc{} || end != text.data() + text.size()) {
+		return std::nullopt;
+	}
+	return value;
+}
+
+auto column_from_name(std::string_view name) -> column {
+	constexpr auto names{std::array<std::pair<std::string_view, column>, 8>{{
+		{"x", x}, {"y", y}, {"z", z}, {"vx", vx}, {"vy", vy}, {"vz", vz}, {"m", mass}, {"mass", mass},
+	}}};
+	auto const found{std::find_if(names.begin(), names.end(), [&](auto const& entry) { return entry.first == name; })};
+	return found == names.end() ? ignored : found->second;
+}
+
+} // namespace
+
+initial_conditions::initial_conditions(std::filesystem::path const& path)
+	: file{path} {
+	TRACE_FUNCTION();
+	auto const bytes{file.bytes()};
+	auto header{body_file_header{}};
+	if (bytes.size() < sizeof(header) || std::memcmp(bytes.data(), body_file_magic.data(), body_file_magic.size()) != 0) {
+		parse_csv(path);
+		return;
+	}
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	if (header.version != body_file_version || header.header_size != sizeof(body_file_header)) {
+		throw std::runtime_error{fmt::format("{} is body file version {}, expected {}", path.string(), header.version, body_file_version)};
+	}
+	// Checked before multiplying, a corrupt body_count could wrap body_bytes around.
+	if (header.body_count > bytes.size() / sizeof(glm::vec4)) {
+		throw std::runtime_error{fmt::format("{} is truncated", path.string())};
+	}
+	auto const body_bytes{header.body_count * sizeof(glm::vec4)};
+	auto const fits = [&](uint64_t offset) { return offset <= bytes.size() && body_bytes <= bytes.size() - offset; };
+	if (!fits(header.positions_offset) || !fits(header.velocities_offset)) {
+		throw std::runtime_error{fmt::format("{} is truncated", path.string())};
+	}
+	if (header.positions_offset % alignof(glm::vec4) != 0 || header.velocities_offset % alignof(glm::vec4) != 0) {
+		throw std::runtime_error{fmt::format("{} has misaligned body arrays", path.string())};
+	}
+	file.advise_sequential();
+	body_positions = {reinterpret_cast<glm::vec4 const*>(bytes.data() + header.positions_offset), header.body_count};
+	body_velocities = {reinterpret_cast<glm::vec4 const*>(bytes.data() + header.velocities_offset), header.body_count};
+}
+
+auto initial_conditions::parse_csv(std::filesystem::path const& path) -> void {
+	TRACE_FUNCTION();
+	auto const text{std::string_view{reinterpret_cast<char const*>(file.bytes().data()), file.bytes().size()}};
+
+	// The column of each field. The first data line is a header if it does not start with a number,
+	// it may name more fields than there are columns.
+	auto columns{std::vector<column>{x, y, z, vx, vy, vz, mass}};
+	size_t data_start{0};
+	for (size_t offset{0}; offset < text.size();) {
+		auto const line_start{offset};
+		auto const line{next_line(text, offset)};
+		if (!is_data_line(line)) {
+			continue;
+		}
+		data_start = line_start;
+		auto first_field{std::string_view{}};
+		split_fields(line, [&](size_t, std::string_view field) {
+			first_field = field;
+			return false;
+		});
+		if (!parse_float(first_field)) {
+			columns.clear();
+			split_fields(line, [&](size_t, std::string_view field) {
+				columns.push_back(column_from_name(field));
+				return true;
+			});
+			data_start = offset;
+		}
+		break;
+	}
+	auto const has_column = [&](column c) { return std::find(columns.begin(), columns.end(), c) != columns.end(); };
+	if (!has_column(x) || !has_column(y) || !has_column(z)) {
+		throw std::runtime_error{fmt::format("{} has no x, y and z columns", path.string())};
+	}
+	data_start = std::min(data_start, text.size());
+
+	// Chunks end on line breaks, then rows are counted and parsed straight into their slots.
+	auto chunk_starts{std::vector<size_t>{data_start}};
+	while (chunk_starts.back() < text.size()) {
+		auto const end{text.find('\n', std::min(chunk_starts.back() + csv_chunk_size, text.size()))};
+		chunk_starts.push_back(end == std::string_view::npos ? text.size() : end + 1);
+	}
+	auto const chunk_count{chunk_starts.size() - 1};
+	auto const chunk_text = [&](size_t chunk) {
+		return text.substr(chunk_starts[chunk], chunk_starts[chunk + 1] - chunk_starts[chunk]);
+	};
+	auto first_rows{std::vector<size_t>(chunk_count + 1, 0)};
+	parallel_for(chunk_count, [&](size_t chunk) {
+		auto const chunk_lines{chunk_text(chunk)};
+		size_t rows{0};
+		for (size_t offset{0}; offset < chunk_lines.size();) {
+			rows += is_data_line(next_line(chunk_lines, offset)) ? 1 : 0;
+		}
+		first_rows[chunk + 1] = rows;
+	});
+	for (size_t chunk{0}; chunk < chunk_count; ++chunk) {
+		first_rows[chunk + 1] += first_rows[chunk];
+	}
+
+	parsed.positions.resize(first_rows.back());
+	parsed.velocities.resize(first_rows.back());
+	auto errors{std::vector<std::string>(chunk_count)};
+	parallel_for(chunk_count, [&](size_t chunk) {
+		auto const chunk_lines{chunk_text(chunk)};
+		auto row{first_rows[chunk]};
+		for (size_t offset{0}; offset < chunk_lines.size();) {
+			auto const line{next_line(chunk_lines, offset)};
+			if (!is_data_line(line)) {
+				continue;
+			}
+			auto values{std::array<float, column_count>{0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 1.f}};
+			auto fields{size_t{0}};
+			auto const valid{split_fields(line, [&](size_t index, std::string_view field) {
+				++fields;
+				if (index >= columns.size() || columns[index] == ignored) {
+					return true;
+				}
+				auto const value{parse_float(field)};
+				if (value) {
+					values[columns[index]] = *value;
+				}
+				return value.has_value();
+			})};
+			if (!valid || fields < 3) {
+				errors[chunk] = fmt::format("{}: can not parse body {}: {}", path.string(), row, line);
+				return;
+			}
+			parsed.positions[row] = glm::vec4{values[x], values[y], values[z], values[mass]};
+			parsed.velocities[row] = glm::vec4{values[vx], values[vy], values[vz], 0.f};
+			++row;
+		}
+	});
+	auto const error{std::find_if(errors.begin(), errors.end(), [](auto const& e) { return !e.empty(); })};
+	if (error != errors.end()) {
+		throw std::runtime_error{*error};
+	}
+	body_positions = parsed.positions;
+	body_velocities = parsed.velocities;
+}
+
+auto save_bodies(std::filesystem::path const& path, std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities) -> void {
+	TRACE_FUNCTION();
+	if (positions.size() != velocities.size()) {
+		throw std::runtime_error{"Every body needs a position and a velocity"};
+	}
+	auto const body_bytes{positions.size() * sizeof(glm::vec4)};
+	auto header{body_file_header{
+		.magic = body_file_magic,
+		.version = body_file_version,
+		.header_size = sizeof(body_file_header),
+		.body_count = positions.size(),
+		.positions_offset = align(sizeof(body_file_header)),
+		.velocities_offset = 0,
+	}};
+	header.velocities_offset = align(header.positions_offset + body_bytes);
+
+	auto* file{std::fopen(path.string().c_str(), "wb")};
+	if (file == nullptr) {
+		throw std::runtime_error{fmt::format("Failed to open {} for writing", path.string())};
+	}
+	constexpr auto zeros{std::array<char, array_alignment>{}};
+	auto ok{std::fwrite(&header, sizeof(header), 1, file) == 1};
+	ok = ok && std::fwrite(zeros.data(), 1, header.positions_offset - sizeof(header), file) == header.positions_offset - sizeof(header);
+	ok = ok && std::fwrite(positions.data(), 1, body_bytes, file) == body_bytes;
+	auto const padding{header.velocities_offset - header.positions_offset - body_bytes};
+	ok = ok && std::fwrite(zeros.data(), 1, padding, file) == padding;
+	ok = ok && std::fwrite(velocities.data(), 1, body_bytes, file) == body_bytes;
+	if (std::fclose(file) != 0 || !ok) {
+		throw std::runtime_error{fmt::format("Failed to write {}", path.string())};
+	}
+}
+
+} // namespace gravity::io
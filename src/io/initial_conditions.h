@@ -0,0 +1,63 @@
+#ifndef INITIAL_CONDITIONS_H
+#define INITIAL_CONDITIONS_H
+
+#include "mapped_file.h"
+#include "particles.h"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <span>
+
+namespace gravity::io {
+
+// Binary body file, the arrays are 64 byte aligned and uploaded from the mapping as is.
+//
+//   body_file_header
+//   positions       body_count * vec4 at positions_offset, std430 with the mass in w
+//   velocities      body_count * vec4 at velocities_offset, w unused
+struct body_file_header {
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t header_size;
+	uint64_t body_count;
+	uint64_t positions_offset;
+	uint64_t velocities_offset;
+};
+
+constexpr auto body_file_magic{std::array<char, 8>{'G', 'R', 'A', 'V', 'B', 'O', 'D', 'Y'}};
+constexpr uint32_t body_file_version{1};
+
+// Bodies to start a simulation from. Binary body files are recognised by their magic, anything
+// else is read as CSV with one body per line: x, y, z and optionally vx, vy, vz and mass,
+// separated by commas or whitespace. A header line naming those columns may reorder them,
+// lines starting with # are skipped. Velocities default to zero and masses to one.
+class initial_conditions {
+public:
+	// Throws std::runtime_error if the file can not be read or a row can not be parsed.
+	explicit initial_conditions(std::filesystem::path const& path);
+
+	// Point into the mapping for binary files.
+	[[nodiscard]] auto positions() const -> std::span<glm::vec4 const> {
+		return body_positions;
+	}
+	[[nodiscard]] auto velocities() const -> std::span<glm::vec4 const> {
+		return body_velocities;
+	}
+
+private:
+	auto parse_csv(std::filesystem::path const& path) -> void;
+
+	mapped_file file;
+	particle_buffers parsed{};
+	std::span<glm::vec4 const> body_positions{};
+	std::span<glm::vec4 const> body_velocities{};
+};
+
+// Throws std::runtime_error.
+auto save_bodies(std::filesystem::path const& path, std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities) -> void;
+
+} // namespace gravity::io
+
+#endif
@@ -0,0 +1,129 @@
+#include "mapped_file.h"
+
+#include <fmt/core.h>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gravity::io {
+
+#ifdef _WIN32
+mapped_file::mapped_file(std::filesystem::path const& path) {
+	file_handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file_handle == INVALID_HANDLE_VALUE) {
+		file_handle = nullptr;
+		throw std::runtime_error{fmt::format("Failed to open {}", path.string())};
+	}
+	LARGE_INTEGER file_size;
+	GetFileSizeEx(file_handle, &file_size);
+	size = static_cast<size_t>(file_size.QuadPart);
+	if (size == 0) {
+		return;
+	}
+	mapping_handle = CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping_handle == nullptr) {
+		unmap();
+		throw std::runtime_error{fmt::format("Failed to map {}", path.string())};
+	}
+	data = static_cast<std::byte const*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr) {
+		unmap();
+		throw std::runtime_error{fmt::format("Failed to map {}", path.string())};
+	}
+}
+
+auto mapped_file::unmap() -> void {
+	if (data != nullptr) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping_handle != nullptr) {
+		CloseHandle(mapping_handle);
+	}
+	if (file_handle != nullptr) {
+		CloseHandle(file_handle);
+	}
+	data = nullptr;
+	size = 0;
+	mapping_handle = nullptr;
+	file_handle = nullptr;
+}
+
+auto mapped_file::advise_sequential() const -> void {}
+#else
+mapped_file::mapped_file(std::filesystem::path const& path) {
+	auto const fd{::open(path.c_str(), O_RDONLY)};
+	if (fd == -1) {
+		throw std::runtime_error{fmt::format("Failed to open {}", path.string())};
+	}
+	struct stat status {};
+	if (fstat(fd, &status) == -1) {
+		close(fd);
+		throw std::runtime_error{fmt::format("Failed to stat {}", path.string())};
+	}
+	size = static_cast<size_t>(status.st_size);
+	if (size > 0) {
+		auto* const mapping{mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+		if (mapping == MAP_FAILED) {
+			close(fd);
+			size = 0;
+			throw std::runtime_error{fmt::format("Failed to map {}", path.string())};
+		}
+		data = static_cast<std::byte const*>(mapping);
+	}
+	// The mapping keeps the file alive.
+	close(fd);
+}
+
+auto mapped_file::unmap() -> void {
+	if (data != nullptr) {
+		munmap(const_cast<std::byte*>(data), size);
+	}
+	data = nullptr;
+	size = 0;
+}
+
+auto mapped_file::advise_sequential() const -> void {
+	if (data != nullptr) {
+		auto* const address{const_cast<std::byte*>(data)};
+		madvise(address, size, MADV_SEQUENTIAL);
+		madvise(address, size, MADV_WILLNEED);
+	}
+}
+#endif
+
+mapped_file::~mapped_file() {
+	unmap();
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+	: data{std::exchange(other.data, nullptr)}
+	, size{std::exchange(other.size, 0)}
+#ifdef _WIN32
+	, file_handle{std::exchange(other.file_handle, nullptr)}
+	, mapping_handle{std::exchange(other.mapping_handle, nullptr)}
+#endif
+{
+}
+
+auto mapped_file::operator=(mapped_file&& other) noexcept -> mapped_file& {
+	if (this != &other) {
+		unmap();
+		data = std::exchange(other.data, nullptr);
+		size = std::exchange(other.size, 0);
+#ifdef _WIN32
+		file_handle = std::exchange(other.file_handle, nullptr);
+		mapping_handle = std::exchange(other.mapping_handle, nullptr);
+#endif
+	}
+	return *this;
+}
+
+} // namespace gravity::io
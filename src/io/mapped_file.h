@@ -0,0 +1,40 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace gravity::io {
+
+// Read only memory mapping of a whole file, throws std::runtime_error if the file can not be mapped.
+class mapped_file {
+public:
+	explicit mapped_file(std::filesystem::path const& path);
+	~mapped_file();
+	mapped_file(mapped_file const&) = delete;
+	auto operator=(mapped_file const&) -> mapped_file& = delete;
+	mapped_file(mapped_file&& other) noexcept;
+	auto operator=(mapped_file&& other) noexcept -> mapped_file&;
+
+	[[nodiscard]] auto bytes() const -> std::span<std::byte const> {
+		return {data, size};
+	}
+
+	// Hint that the mapping is read front to back once, e.g. straight into a GPU buffer.
+	auto advise_sequential() const -> void;
+
+private:
+	auto unmap() -> void;
+
+	std::byte const* data{nullptr};
+	size_t size{0};
+#ifdef _WIN32
+	void* file_handle{nullptr};
+	void* mapping_handle{nullptr};
+#endif
+};
+
+} // namespace gravity::io
+
+#endif
@@ -0,0 +1,233 @@
+#include "timeline.h"
+
+#include "trajectory_writer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fmt/core.h>
+#include <stdexcept>
+#include <trace.h>
+
+namespace gravity::io {
+
+timeline::timeline(std::filesystem::path const& path, timeline_options options)
+	: file{path}
+	, options{options} {
+	TRACE_FUNCTION();
+	auto const bytes{file.bytes()};
+	auto header{trajectory_header{}};
+	if (bytes.size() < sizeof(header)) {
+		throw std::runtime_error{fmt::format("{} is not a trajectory", path.string())};
+	}
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	if (header.magic != trajectory_magic) {
+		throw std::runtime_error{fmt::format("{} is not a trajectory", path.string())};
+	}
+	if (header.version > trajectory_version) {
+		throw std::runtime_error{fmt::format("{} has trajectory version {}, expected at most {}", path.string(), header.version, trajectory_version)};
+	}
+
+	// Only the chunk headers are touched, a frame cut short by a crashed writer ends the timeline.
+	auto offset{uint64_t{sizeof(header)}};
+	while (offset + sizeof(trajectory_chunk_header) <= bytes.size()) {
+		auto chunk{trajectory_chunk_header{}};
+		std::memcpy(&chunk, bytes.data() + offset, sizeof(chunk));
+		auto const payload_offset{offset + sizeof(chunk)};
+		if (chunk.magic != trajectory_chunk_magic || chunk.payload_size > bytes.size() - payload_offset) {
+			break;
+		}
+		auto const compressed{(chunk.fields & trajectory_field::compressed) != 0};
+		auto const keyframe{!compressed || frame_decoder::is_keyframe(bytes.subspan(payload_offset, chunk.payload_size))};
+		if (!keyframe && index.empty()) {
+			throw std::runtime_error{fmt::format("{} starts with a delta frame", path.string())};
+		}
+		index.push_back(entry{
+			.offset = payload_offset,
+			.payload_size = chunk.payload_size,
+			.tick = chunk.tick,
+			.time = chunk.time,
+			.fields = chunk.fields,
+			.keyframe = keyframe ? index.size() : index.back().keyframe,
+		});
+		offset = payload_offset + chunk.payload_size;
+	}
+	if (index.empty()) {
+		throw std::runtime_error{fmt::format("{} has no frames", path.string())};
+	}
+	prefetch_thread = std::thread{[this] { prefetch(); }};
+}
+
+timeline::~timeline() {
+	{
+		auto const lock{std::scoped_lock{cache_mutex}};
+		stopping = true;
+	}
+	prefetch_condition.notify_one();
+	prefetch_thread.join();
+}
+
+auto timeline::find(double time) const -> size_t {
+	auto const after{std::upper_bound(index.begin(), index.end(), time, [](double t, entry const& e) { return t < e.time; })};
+	return after == index.begin() ? 0 : static_cast<size_t>(after - index.begin() - 1);
+}
+
+auto timeline::frame(size_t frame) -> std::shared_ptr<timeline_frame const> {
+	TRACE_FUNCTION();
+	auto decoded{lookup(frame)};
+	if (!decoded) {
+		decoded = decode(frame, foreground);
+	}
+	{
+		auto const lock{std::scoped_lock{cache_mutex}};
+		prefetch_center = frame;
+	}
+	prefetch_condition.notify_one();
+	return decoded;
+}
+
+auto timeline::cached_bytes() const -> size_t {
+	auto const lock{std::scoped_lock{cache_mutex}};
+	return cache_bytes;
+}
+
+auto timeline::decode(size_t frame, sequential_decoder& sequence) -> std::shared_ptr<timeline_frame const> {
+	TRACE_FUNCTION();
+	auto const& target{index[frame]};
+	// Keep decoding forwards if the decoder already holds the previous frame, otherwise start over at the keyframe.
+	auto first{target.keyframe};
+	if (sequence.last != SIZE_MAX && sequence.last < frame && sequence.last >= target.keyframe) {
+		first = sequence.last + 1;
+	}
+	auto decoded{std::shared_ptr<timeline_frame>{}};
+	for (auto i{first}; i <= frame; ++i) {
+		decoded = decode_one(i, sequence);
+		// Frames passed on the way are worth keeping if they are close enough to be scrubbed to next.
+		if (i < frame && i + options.prefetch_radius >= frame) {
+			store(i, decoded);
+		}
+	}
+	store(frame, decoded);
+	return decoded;
+}
+
+auto timeline::decode_one(size_t frame, sequential_decoder& sequence) const -> std::shared_ptr<timeline_frame> {
+	auto const& e{index[frame]};
+	auto const payload{file.bytes().subspan(e.offset, e.payload_size)};
+	auto decoded{std::make_shared<timeline_frame>(timeline_frame{e.tick, e.time, {}, {}})};
+	sequence.last = SIZE_MAX;
+	if ((e.fields & trajectory_field::compressed) != 0) {
+		if (frame == e.keyframe) {
+			sequence.decoder.reset();
+		}
+		sequence.decoder.decode(payload, decoded->positions, decoded->velocities);
+		sequence.last = frame;
+		return decoded;
+	}
+
+	auto const has = [&](uint32_t field) { return (e.fields & field) != 0; };
+	auto const floats_per_body{(has(trajectory_field::positions) ? 3u : 0u) + (has(trajectory_field::velocities) ? 3u : 0u) + (has(trajectory_field::masses) ? 1u : 0u)};
+	if (floats_per_body == 0 || payload.size() % (floats_per_body * sizeof(float)) != 0) {
+		throw std::runtime_error{fmt::format("Trajectory frame {} has an invalid size", e.tick)};
+	}
+	auto const body_count{payload.size() / (floats_per_body * sizeof(float))};
+	auto values{std::vector<float>(payload.size() / sizeof(float))};
+	std::memcpy(values.data(), payload.data(), payload.size());
+	auto const* cursor{values.data()};
+	auto const read_xyz = [&](std::vector<glm::vec4>& target) {
+		target.resize(body_count);
+		for (auto& v : target) {
+			v = glm::vec4{cursor[0], cursor[1], cursor[2], 0.f};
+			cursor += 3;
+		}
+	};
+	decoded->positions.resize(body_count);
+	if (has(trajectory_field::positions)) {
+		read_xyz(decoded->positions);
+	}
+	if (has(trajectory_field::velocities)) {
+		read_xyz(decoded->velocities);
+	}
+	if (has(trajectory_field::masses)) {
+		for (auto& p : decoded->positions) {
+			p.w = *cursor++;
+		}
+	}
+	return decoded;
+}
+
+auto timeline::lookup(size_t frame) -> std::shared_ptr<timeline_frame const> {
+	auto const lock{std::scoped_lock{cache_mutex}};
+	auto const found{cache.find(frame)};
+	if (found == cache.end()) {
+		return nullptr;
+	}
+	recency.splice(recency.begin(), recency, found->second.second);
+	return found->second.first;
+}
+
+auto timeline::store(size_t frame, std::shared_ptr<timeline_frame const> decoded) -> void {
+	auto const lock{std::scoped_lock{cache_mutex}};
+	if (cache.contains(frame) || decoded->bytes() > options.cache_budget) {
+		return;
+	}
+	while (!recency.empty() && cache_bytes + decoded->bytes() > options.cache_budget) {
+		auto const evicted{cache.find(recency.back())};
+		cache_bytes -= evicted->second.first->bytes();
+		cache.erase(evicted);
+		recency.pop_back();
+	}
+	cache_bytes += decoded->bytes();
+	recency.push_front(frame);
+	cache.emplace(frame, std::pair{std::move(decoded), recency.begin()});
+}
+
+auto timeline::prefetch() -> void {
+	trace::set_thread_name("timeline prefetch");
+	auto background{sequential_decoder{}};
+	auto done{SIZE_MAX};
+	while (true) {
+		auto center{SIZE_MAX};
+		{
+			auto lock{std::unique_lock{cache_mutex}};
+			prefetch_condition.wait(lock, [&] { return stopping || prefetch_center != done; });
+			if (stopping) {
+				return;
+			}
+			center = prefetch_center;
+		}
+		// Forwards first since that is the direction of playback.
+		auto candidates{std::vector<size_t>{}};
+		for (size_t distance{1}; distance <= options.prefetch_radius; ++distance) {
+			if (center + distance < index.size()) {
+				candidates.push_back(center + distance);
+			}
+		}
+		for (size_t distance{1}; distance <= options.prefetch_radius && distance <= center; ++distance) {
+			candidates.push_back(center - distance);
+		}
+		auto interrupted{false};
+		for (auto const candidate : candidates) {
+			{
+				auto const lock{std::scoped_lock{cache_mutex}};
+				if (stopping || prefetch_center != center) {
+					interrupted = true;
+					break;
+				}
+				if (cache.contains(candidate)) {
+					continue;
+				}
+			}
+			try {
+				decode(candidate, background);
+			} catch (std::runtime_error const&) {
+				// The foreground decode of the same frame reports it.
+				background.last = SIZE_MAX;
+			}
+		}
+		if (!interrupted) {
+			done = center;
+		}
+	}
+}
+
+} // namespace gravity::io
@@ -0,0 +1,110 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "mapped_file.h"
+#include "trajectory_codec.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace gravity::io {
+
+struct timeline_options {
+	// Decoded frames kept in memory, least recently used frames are evicted first.
+	size_t cache_budget{size_t{1} << 30};
+	// Frames on each side of the current one that are decoded in the background.
+	uint32_t prefetch_radius{4};
+};
+
+struct timeline_frame {
+	uint64_t tick;
+	double time;
+	std::vector<glm::vec4> positions;
+	std::vector<glm::vec4> velocities;
+
+	[[nodiscard]] auto bytes() const -> size_t {
+		return (positions.size() + velocities.size()) * sizeof(glm::vec4);
+	}
+};
+
+// Random access to a trajectory file for replay. The file is mapped and indexed once
+// when opened, compressed frames are decoded from their keyframe and neighbouring
+// frames are prefetched on a background thread.
+class timeline {
+public:
+	// Throws std::runtime_error if path is not a trajectory file.
+	explicit timeline(std::filesystem::path const& path, timeline_options options = {});
+	~timeline();
+	timeline(timeline const&) = delete;
+	auto operator=(timeline const&) -> timeline& = delete;
+	timeline(timeline&&) = delete;
+	auto operator=(timeline&&) -> timeline& = delete;
+
+	[[nodiscard]] auto size() const -> size_t {
+		return index.size();
+	}
+	[[nodiscard]] auto tick(size_t frame) const -> uint64_t {
+		return index[frame].tick;
+	}
+	[[nodiscard]] auto time(size_t frame) const -> double {
+		return index[frame].time;
+	}
+	// Last frame at or before time.
+	[[nodiscard]] auto find(double time) const -> size_t;
+
+	// Decodes the frame on the calling thread unless it is cached and queues its neighbours for prefetching.
+	// Throws std::runtime_error if the frame is corrupt.
+	auto frame(size_t frame) -> std::shared_ptr<timeline_frame const>;
+	[[nodiscard]] auto cached_bytes() const -> size_t;
+
+private:
+	struct entry {
+		uint64_t offset;
+		uint64_t payload_size;
+		uint64_t tick;
+		double time;
+		uint32_t fields;
+		// Frame to start decoding from.
+		size_t keyframe;
+	};
+
+	// A decoder that remembers which frame it decoded last, so playing forwards decodes one frame at a time.
+	struct sequential_decoder {
+		frame_decoder decoder{};
+		size_t last{SIZE_MAX};
+	};
+
+	auto decode(size_t frame, sequential_decoder& sequence) -> std::shared_ptr<timeline_frame const>;
+	auto decode_one(size_t frame, sequential_decoder& sequence) const -> std::shared_ptr<timeline_frame>;
+	auto lookup(size_t frame) -> std::shared_ptr<timeline_frame const>;
+	auto store(size_t frame, std::shared_ptr<timeline_frame const> decoded) -> void;
+	auto prefetch() -> void;
+
+	mapped_file file;
+	timeline_options options;
+	std::vector<entry> index{};
+	sequential_decoder foreground{};
+
+	mutable std::mutex cache_mutex{};
+	std::unordered_map<size_t, std::pair<std::shared_ptr<timeline_frame const>, std::list<size_t>::iterator>> cache{};
+	// Most recently used first.
+	std::list<size_t> recency{};
+	size_t cache_bytes{0};
+
+	std::condition_variable prefetch_condition{};
+	size_t prefetch_center{SIZE_MAX};
+	bool stopping{false};
+	std::thread prefetch_thread{};
+};
+
+} // namespace gravity::io
+
+#endif
@@ -0,0 +1,442 @@
+#include "trajectory_codec.h"
+
+#include "trajectory_writer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <parallel.h>
+#include <stdexcept>
+#include <trace.h>
+
+namespace gravity::io {
+
+namespace {
+
+// Byte wise rANS with 32 bit state, see https://github.com/rygorous/ryg_rans
+constexpr uint32_t rans_scale_bits{12};
+constexpr uint32_t rans_scale{1u << rans_scale_bits};
+constexpr uint32_t rans_lower_bound{1u << 23};
+
+using frequency_table = std::array<uint16_t, 256>;
+
+enum class chunk_mode : uint32_t {
+	raw,
+	rans,
+};
+
+struct chunk_header {
+	chunk_mode mode;
+	uint32_t raw_size;
+};
+
+auto zigzag(uint32_t value) -> uint32_t {
+	return (value << 1) ^ (0u - (value >> 31));
+}
+
+auto unzigzag(uint32_t value) -> uint32_t {
+	return (value >> 1) ^ (0u - (value & 1));
+}
+
+auto put_varint(std::vector<uint8_t>& out, uint32_t value) -> void {
+	while (value >= 0x80) {
+		out.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+class varint_reader {
+public:
+	explicit varint_reader(std::span<uint8_t const> bytes)
+		: bytes{bytes} {}
+
+	auto next() -> uint32_t {
+		uint32_t value{0};
+		for (uint32_t shift{0}; shift < 35; shift += 7) {
+			if (offset == bytes.size()) {
+				failed = true;
+				return 0;
+			}
+			auto const byte{bytes[offset++]};
+			value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) {
+				return value;
+			}
+		}
+		failed = true;
+		return 0;
+	}
+
+	bool failed{false};
+
+private:
+	std::span<uint8_t const> bytes;
+	size_t offset{0};
+};
+
+auto append(std::vector<std::byte>& out, void const* data, size_t size) -> void {
+	auto const* first{static_cast<std::byte const*>(data)};
+	out.insert(out.end(), first, first + size);
+}
+
+// Scales symbol counts to sum to rans_scale, every symbol that occurs keeps at least 1.
+auto normalize_frequencies(std::array<uint32_t, 256> const& counts, size_t total) -> frequency_table {
+	auto frequencies{frequency_table{}};
+	uint32_t sum{0};
+	for (size_t symbol{0}; symbol < counts.size(); ++symbol) {
+		if (counts[symbol] != 0) {
+			auto const scaled{static_cast<uint32_t>(static_cast<uint64_t>(counts[symbol]) * rans_scale / total)};
+			frequencies[symbol] = static_cast<uint16_t>(std::max(scaled, 1u));
+			sum += frequencies[symbol];
+		}
+	}
+	auto const largest = [&] { return std::distance(frequencies.begin(), std::ranges::max_element(frequencies)); };
+	while (sum > rans_scale) {
+		--frequencies[static_cast<size_t>(largest())];
+		--sum;
+	}
+	frequencies[static_cast<size_t>(largest())] += static_cast<uint16_t>(rans_scale - sum);
+	return frequencies;
+}
+
+auto cumulative(frequency_table const& frequencies) -> std::array<uint32_t, 257> {
+	auto starts{std::array<uint32_t, 257>{}};
+	for (size_t symbol{0}; symbol < frequencies.size(); ++symbol) {
+		starts[symbol + 1] = starts[symbol] + frequencies[symbol];
+	}
+	return starts;
+}
+
+auto compress_chunk(std::vector<uint8_t> const& raw, std::vector<std::byte>& out) -> void {
+	auto counts{std::array<uint32_t, 256>{}};
+	for (auto const byte : raw) {
+		++counts[byte];
+	}
+	if (raw.empty()) {
+		auto const header{chunk_header{chunk_mode::raw, 0}};
+		append(out, &header, sizeof(header));
+		return;
+	}
+	auto const frequencies{normalize_frequencies(counts, raw.size())};
+	auto const starts{cumulative(frequencies)};
+
+	// Symbols cost at most rans_scale_bits each, encoded back to front.
+	auto encoded{std::vector<uint8_t>(raw.size() * 2 + 8)};
+	auto* const end{encoded.data() + encoded.size()};
+	auto* cursor{end};
+	auto state{rans_lower_bound};
+	for (auto i{raw.size()}; i-- > 0;) {
+		auto const symbol{raw[i]};
+		auto const frequency{static_cast<uint32_t>(frequencies[symbol])};
+		auto const state_max{((rans_lower_bound >> rans_scale_bits) << 8) * frequency};
+		while (state >= state_max) {
+			*--cursor = static_cast<uint8_t>(state & 0xff);
+			state >>= 8;
+		}
+		state = ((state / frequency) << rans_scale_bits) + (state % frequency) + starts[symbol];
+	}
+	cursor -= sizeof(state);
+	std::memcpy(cursor, &state, sizeof(state));
+
+	auto const encoded_size{static_cast<size_t>(end - cursor)};
+	if (encoded_size + sizeof(frequency_table) >= raw.size()) {
+		auto const header{chunk_header{chunk_mode::raw, static_cast<uint32_t>(raw.size())}};
+		append(out, &header, sizeof(header));
+		append(out, raw.data(), raw.size());
+		return;
+	}
+	auto const header{chunk_header{chunk_mode::rans, static_cast<uint32_t>(raw.size())}};
+	append(out, &header, sizeof(header));
+	append(out, frequencies.data(), sizeof(frequency_table));
+	append(out, cursor, encoded_size);
+}
+
+auto decompress_chunk(std::span<std::byte const> chunk, std::vector<uint8_t>& raw) -> bool {
+	auto header{chunk_header{}};
+	if (chunk.size() < sizeof(header)) {
+		return false;
+	}
+	std::memcpy(&header, chunk.data(), sizeof(header));
+	auto payload{chunk.subspan(sizeof(header))};
+	raw.resize(header.raw_size);
+	if (header.mode == chunk_mode::raw) {
+		if (payload.size() != raw.size()) {
+			return false;
+		}
+		std::memcpy(raw.data(), payload.data(), raw.size());
+		return true;
+	}
+	if (header.mode != chunk_mode::rans || payload.size() < sizeof(frequency_table) + sizeof(uint32_t)) {
+		return false;
+	}
+	auto frequencies{frequency_table{}};
+	std::memcpy(frequencies.data(), payload.data(), sizeof(frequency_table));
+	payload = payload.subspan(sizeof(frequency_table));
+	auto const starts{cumulative(frequencies)};
+	if (starts.back() != rans_scale) {
+		return false;
+	}
+	auto symbols{std::array<uint8_t, rans_scale>{}};
+	for (size_t symbol{0}; symbol < frequencies.size(); ++symbol) {
+		std::fill(symbols.begin() + starts[symbol], symbols.begin() + starts[symbol + 1], static_cast<uint8_t>(symbol));
+	}
+
+	auto const* cursor{reinterpret_cast<uint8_t const*>(payload.data())};
+	auto const* const end{cursor + payload.size()};
+	uint32_t state;
+	std::memcpy(&state, cursor, sizeof(state));
+	cursor += sizeof(state);
+	for (auto& byte : raw) {
+		auto const slot{state & (rans_scale - 1)};
+		auto const symbol{symbols[slot]};
+		byte = symbol;
+		state = frequencies[symbol] * (state >> rans_scale_bits) + slot - starts[symbol];
+		while (state < rans_lower_bound) {
+			if (cursor == end) {
+				return false;
+			}
+			state = (state << 8) | *cursor++;
+		}
+	}
+	return true;
+}
+
+auto bounding_grid(std::span<glm::vec4 const> values, double relative_error) -> quantization_grid {
+	auto low{std::array<float, 3>{}};
+	auto high{std::array<float, 3>{}};
+	low.fill(std::numeric_limits<float>::max());
+	high.fill(std::numeric_limits<float>::lowest());
+	for (auto const& value : values) {
+		for (int c{0}; c < 3; ++c) {
+			low[c] = std::min(low[c], value[c]);
+			high[c] = std::max(high[c], value[c]);
+		}
+	}
+	auto extent{0.0};
+	for (size_t c{0}; c < 3; ++c) {
+		extent = std::max(extent, static_cast<double>(high[c]) - static_cast<double>(low[c]));
+	}
+	if (values.empty() || !std::isfinite(extent) || extent <= 0.0) {
+		return quantization_grid{};
+	}
+	// Rounding to the nearest grid point is off by at most half a step.
+	return quantization_grid{low, static_cast<float>(2.0 * std::max(relative_error, 1e-9) * extent)};
+}
+
+auto quantize(float value, float origin, float step) -> int64_t {
+	return std::llround((static_cast<double>(value) - static_cast<double>(origin)) / static_cast<double>(step));
+}
+
+auto dequantize(uint32_t quantized, float origin, float step) -> float {
+	return static_cast<float>(static_cast<double>(origin) + static_cast<double>(static_cast<int32_t>(quantized)) * static_cast<double>(step));
+}
+
+} // namespace
+
+frame_encoder::frame_encoder(codec_options const& options, uint32_t fields)
+	: options{options}
+	, fields{fields & (trajectory_field::positions | trajectory_field::velocities | trajectory_field::masses)} {
+	this->options.keyframe_interval = std::max(this->options.keyframe_interval, 1u);
+	this->options.chunk_bodies = std::max(this->options.chunk_bodies, 1u);
+}
+
+auto frame_encoder::try_encode(std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities, bool keyframe) -> bool {
+	auto const body_count{positions.size()};
+	auto const frame_fields{velocities.size() == body_count ? fields : fields & ~uint32_t{trajectory_field::velocities}};
+	if (keyframe) {
+		positions_grid = bounding_grid(positions, options.relative_error);
+		velocities_grid = bounding_grid(velocities, options.relative_error);
+		previous_positions.assign(3 * body_count, 0);
+		previous_velocities.assign(3 * body_count, 0);
+		previous_masses.assign(body_count, 0);
+	}
+
+	auto const chunk_count{(body_count + options.chunk_bodies - 1) / options.chunk_bodies};
+	chunks.resize(chunk_count);
+	auto overflow{std::atomic<bool>{false}};
+	parallel_for(chunk_count, [&](size_t chunk) {
+		auto const first{chunk * options.chunk_bodies};
+		auto const last{std::min(first + options.chunk_bodies, body_count)};
+		auto raw{std::vector<uint8_t>{}};
+		raw.reserve((last - first) * 16);
+		auto const encode_vectors = [&](std::span<glm::vec4 const> values, quantization_grid const& grid, std::vector<int32_t>& previous) {
+			for (auto i{first}; i < last; ++i) {
+				for (int c{0}; c < 3; ++c) {
+					auto const quantized{quantize(values[i][c], grid.origin[static_cast<size_t>(c)], grid.step)};
+					if (quantized < std::numeric_limits<int32_t>::min() || quantized > std::numeric_limits<int32_t>::max()) {
+						overflow = true;
+						return;
+					}
+					auto& reference{previous[3 * i + static_cast<size_t>(c)]};
+					put_varint(raw, zigzag(static_cast<uint32_t>(quantized) - static_cast<uint32_t>(reference)));
+					reference = static_cast<int32_t>(quantized);
+				}
+			}
+		};
+		if ((frame_fields & trajectory_field::positions) != 0) {
+			encode_vectors(positions, positions_grid, previous_positions);
+		}
+		if ((frame_fields & trajectory_field::velocities) != 0) {
+			encode_vectors(velocities, velocities_grid, previous_velocities);
+		}
+		if ((frame_fields & trajectory_field::masses) != 0) {
+			for (auto i{first}; i < last; ++i) {
+				auto const bits{std::bit_cast<uint32_t>(positions[i].w)};
+				put_varint(raw, bits ^ previous_masses[i]);
+				previous_masses[i] = bits;
+			}
+		}
+		chunks[chunk].clear();
+		compress_chunk(raw, chunks[chunk]);
+	});
+	return !overflow;
+}
+
+auto frame_encoder::encode(std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities, std::vector<std::byte>& out) -> void {
+	TRACE_FUNCTION();
+	auto const start{std::chrono::steady_clock::now()};
+	auto const body_count{positions.size()};
+	auto keyframe{frames_since_keyframe == 0 || frames_since_keyframe >= options.keyframe_interval || previous_masses.size() != body_count};
+	// Bodies that left the grid of the last keyframe start a new one.
+	if (!try_encode(positions, velocities, keyframe)) {
+		keyframe = true;
+		try_encode(positions, velocities, keyframe);
+	}
+	frames_since_keyframe = keyframe ? 1 : frames_since_keyframe + 1;
+
+	auto const frame_fields{velocities.size() == body_count ? fields : fields & ~uint32_t{trajectory_field::velocities}};
+	auto const header{encoded_frame_header{
+		.flags = keyframe ? keyframe_flag : 0,
+		.fields = frame_fields,
+		.body_count = body_count,
+		.chunk_bodies = options.chunk_bodies,
+		.chunk_count = static_cast<uint32_t>(chunks.size()),
+		.positions_grid = positions_grid,
+		.velocities_grid = velocities_grid,
+	}};
+	auto const first_byte{out.size()};
+	append(out, &header, sizeof(header));
+	for (auto const& chunk : chunks) {
+		auto const size{static_cast<uint32_t>(chunk.size())};
+		append(out, &size, sizeof(size));
+	}
+	for (auto const& chunk : chunks) {
+		append(out, chunk.data(), chunk.size());
+	}
+
+	auto const vector_fields{static_cast<uint64_t>(std::popcount(frame_fields & (trajectory_field::positions | trajectory_field::velocities)))};
+	auto const mass_field{(frame_fields & trajectory_field::masses) != 0 ? uint64_t{1} : uint64_t{0}};
+	++totals.frames;
+	totals.keyframes += keyframe ? 1 : 0;
+	totals.raw_bytes += body_count * (vector_fields * 3 + mass_field) * sizeof(float);
+	totals.encoded_bytes += out.size() - first_byte;
+	totals.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+auto frame_decoder::is_keyframe(std::span<std::byte const> frame) -> bool {
+	auto header{encoded_frame_header{}};
+	if (frame.size() < sizeof(header)) {
+		return false;
+	}
+	std::memcpy(&header, frame.data(), sizeof(header));
+	return (header.flags & keyframe_flag) != 0;
+}
+
+auto frame_decoder::reset() -> void {
+	has_reference = false;
+}
+
+auto frame_decoder::decode(std::span<std::byte const> frame, std::vector<glm::vec4>& positions, std::vector<glm::vec4>& velocities) -> void {
+	TRACE_FUNCTION();
+	auto header{encoded_frame_header{}};
+	if (frame.size() < sizeof(header)) {
+		throw std::runtime_error{"Encoded frame is truncated"};
+	}
+	std::memcpy(&header, frame.data(), sizeof(header));
+	auto const keyframe{(header.flags & keyframe_flag) != 0};
+	auto const body_count{static_cast<size_t>(header.body_count)};
+	if (!keyframe && (!has_reference || previous_masses.size() != body_count)) {
+		throw std::runtime_error{"Delta frame without its keyframe"};
+	}
+	if (header.chunk_bodies == 0 || header.chunk_count != (body_count + header.chunk_bodies - 1) / header.chunk_bodies) {
+		throw std::runtime_error{"Encoded frame has an invalid chunk table"};
+	}
+
+	// Chunk offsets from the size table.
+	auto const table_offset{sizeof(header)};
+	auto const table_size{header.chunk_count * sizeof(uint32_t)};
+	if (frame.size() < table_offset + table_size) {
+		throw std::runtime_error{"Encoded frame is truncated"};
+	}
+	auto offsets{std::vector<size_t>(header.chunk_count + 1)};
+	offsets[0] = table_offset + table_size;
+	for (size_t chunk{0}; chunk < header.chunk_count; ++chunk) {
+		uint32_t size;
+		std::memcpy(&size, frame.data() + table_offset + chunk * sizeof(uint32_t), sizeof(size));
+		offsets[chunk + 1] = offsets[chunk] + size;
+	}
+	if (offsets.back() > frame.size()) {
+		throw std::runtime_error{"Encoded frame is truncated"};
+	}
+
+	if (keyframe) {
+		previous_positions.assign(3 * body_count, 0);
+		previous_velocities.assign(3 * body_count, 0);
+		previous_masses.assign(body_count, 0);
+	}
+	positions.assign(body_count, glm::vec4{0.f});
+	if ((header.fields & trajectory_field::velocities) != 0) {
+		velocities.assign(body_count, glm::vec4{0.f});
+	} else {
+		velocities.clear();
+	}
+	scratch.resize(header.chunk_count);
+
+	auto failed{std::atomic<bool>{false}};
+	parallel_for(header.chunk_count, [&](size_t chunk) {
+		auto& raw{scratch[chunk]};
+		if (!decompress_chunk(frame.subspan(offsets[chunk], offsets[chunk + 1] - offsets[chunk]), raw)) {
+			failed = true;
+			return;
+		}
+		auto reader{varint_reader{raw}};
+		auto const first{chunk * header.chunk_bodies};
+		auto const last{std::min(first + header.chunk_bodies, body_count)};
+		auto const decode_vectors = [&](std::vector<glm::vec4>& values, quantization_grid const& grid, std::vector<int32_t>& previous) {
+			for (auto i{first}; i < last; ++i) {
+				for (int c{0}; c < 3; ++c) {
+					auto& reference{previous[3 * i + static_cast<size_t>(c)]};
+					auto const quantized{static_cast<uint32_t>(reference) + unzigzag(reader.next())};
+					reference = static_cast<int32_t>(quantized);
+					values[i][c] = dequantize(quantized, grid.origin[static_cast<size_t>(c)], grid.step);
+				}
+			}
+		};
+		if ((header.fields & trajectory_field::positions) != 0) {
+			decode_vectors(positions, header.positions_grid, previous_positions);
+		}
+		if ((header.fields & trajectory_field::velocities) != 0) {
+			decode_vectors(velocities, header.velocities_grid, previous_velocities);
+		}
+		if ((header.fields & trajectory_field::masses) != 0) {
+			for (auto i{first}; i < last; ++i) {
+				previous_masses[i] ^= reader.next();
+				positions[i].w = std::bit_cast<float>(previous_masses[i]);
+			}
+		}
+		if (reader.failed) {
+			failed = true;
+		}
+	});
+	has_reference = !failed;
+	if (failed) {
+		throw std::runtime_error{"Encoded frame is corrupt"};
+	}
+}
+
+} // namespace gravity::io
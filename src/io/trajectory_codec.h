@@ -0,0 +1,107 @@
+#ifndef TRAJECTORY_CODEC_H
+#define TRAJECTORY_CODEC_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+namespace gravity::io {
+
+// Lossy frame codec for trajectories. Positions and velocities are quantized on a grid whose
+// step is derived from the error bound and the bounding box of the last keyframe. Frames between
+// keyframes store the difference to the previous frame on that grid, so decoding only has to
+// start at the nearest keyframe. The residuals are zigzag varints compressed with an order 0
+// rANS coder, in independent chunks of bodies that are encoded and decoded in parallel.
+//
+// An encoded frame is an encoded_frame_header, chunk_count uint32 chunk sizes and the chunks.
+struct codec_options {
+	// Maximum error relative to the largest extent of the bounding box.
+	double relative_error{1e-5};
+	uint32_t keyframe_interval{32};
+	uint32_t chunk_bodies{1 << 16};
+};
+
+struct quantization_grid {
+	std::array<float, 3> origin{};
+	float step{1.f};
+};
+
+struct encoded_frame_header {
+	uint32_t flags;
+	uint32_t fields;
+	uint64_t body_count;
+	uint32_t chunk_bodies;
+	uint32_t chunk_count;
+	quantization_grid positions_grid;
+	quantization_grid velocities_grid;
+};
+
+constexpr uint32_t keyframe_flag{1};
+
+struct codec_stats {
+	uint64_t frames{0};
+	uint64_t keyframes{0};
+	uint64_t raw_bytes{0};
+	uint64_t encoded_bytes{0};
+	double seconds{0.0};
+
+	[[nodiscard]] auto ratio() const -> double {
+		return encoded_bytes == 0 ? 0.0 : static_cast<double>(raw_bytes) / static_cast<double>(encoded_bytes);
+	}
+	// Of the uncompressed float data.
+	[[nodiscard]] auto throughput_mbs() const -> double {
+		return seconds == 0.0 ? 0.0 : static_cast<double>(raw_bytes) / seconds / 1e6;
+	}
+};
+
+class frame_encoder {
+public:
+	// fields are trajectory_field bits.
+	frame_encoder(codec_options const& options, uint32_t fields);
+
+	// Appends the encoded frame to out. velocities may be empty if they are not encoded.
+	auto encode(std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities, std::vector<std::byte>& out) -> void;
+	[[nodiscard]] auto stats() const -> codec_stats const& {
+		return totals;
+	}
+
+private:
+	auto try_encode(std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities, bool keyframe) -> bool;
+
+	codec_options options;
+	uint32_t fields;
+	uint64_t frames_since_keyframe{0};
+	quantization_grid positions_grid{};
+	quantization_grid velocities_grid{};
+	// Quantized values of the previous frame, three per body.
+	std::vector<int32_t> previous_positions{};
+	std::vector<int32_t> previous_velocities{};
+	std::vector<uint32_t> previous_masses{};
+	std::vector<std::vector<std::byte>> chunks{};
+	codec_stats totals{};
+};
+
+class frame_decoder {
+public:
+	// Decodes a frame written by frame_encoder, delta frames need the frames since their keyframe
+	// to have been decoded first. Fields that were not encoded are left zero, masses go in positions.w.
+	// Throws std::runtime_error on corrupt data or a delta frame without its keyframe.
+	auto decode(std::span<std::byte const> frame, std::vector<glm::vec4>& positions, std::vector<glm::vec4>& velocities) -> void;
+	[[nodiscard]] static auto is_keyframe(std::span<std::byte const> frame) -> bool;
+	// Forget the previous frame, e.g. before seeking to a keyframe.
+	auto reset() -> void;
+
+private:
+	bool has_reference{false};
+	std::vector<int32_t> previous_positions{};
+	std::vector<int32_t> previous_velocities{};
+	std::vector<uint32_t> previous_masses{};
+	std::vector<std::vector<uint8_t>> scratch{};
+};
+
+} // namespace gravity::io
+
+#endif
@@ -0,0 +1,193 @@
+#include "trajectory_writer.h"
+
+#include <algorithm>
+#include <fmt/core.h>
+#include <stdexcept>
+#include <trace.h>
+#include <utility>
+
+namespace gravity::io {
+
+namespace {
+auto kept_bodies(size_t body_count, uint32_t decimation) -> size_t {
+	return (body_count + decimation - 1) / decimation;
+}
+} // namespace
+
+trajectory_writer::trajectory_writer(trajectory_options options)
+	: config{std::move(options)}
+	, file{std::fopen(config.path.string().c_str(), "wb")}
+	, encoder{config.codec, config.fields} {
+	if (file == nullptr) {
+		throw std::runtime_error{fmt::format("Failed to open {} for writing", config.path.string())};
+	}
+	config.interval = std::max(config.interval, 1u);
+	config.decimation = std::max(config.decimation, 1u);
+	auto const header{trajectory_header{
+		.magic = trajectory_magic,
+		.version = trajectory_version,
+		.fields = config.fields,
+		.interval = config.interval,
+		.decimation = config.decimation,
+	}};
+	std::fwrite(&header, sizeof(header), 1, file);
+	writer_thread = std::thread{[this] { run(); }};
+}
+
+trajectory_writer::~trajectory_writer() {
+	{
+		auto const lock{std::scoped_lock{queue_mutex}};
+		stopping = true;
+	}
+	queue_condition.notify_one();
+	writer_thread.join();
+	std::fclose(file);
+	if (disk_full) {
+		fmt::print(stderr, "Trajectory: stopped recording at the disk budget of {} MB, dropped {} frames\n", config.disk_budget >> 20, frames_dropped.load());
+	} else if (frames_dropped > 0) {
+		fmt::print(stderr, "Trajectory: dropped {} frames, the writer could not keep up within {} MB\n", frames_dropped.load(), config.memory_budget >> 20);
+	}
+	if (config.compress && codec_totals.frames > 0) {
+		fmt::print("Trajectory: compressed {} frames ({} keyframes) {:.2f}x at {:.1f} MB/s\n", codec_totals.frames, codec_totals.keyframes, codec_totals.ratio(), codec_totals.throughput_mbs());
+	}
+}
+
+auto trajectory_writer::submit(uint64_t tick, double time, std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities) -> bool {
+	TRACE_FUNCTION();
+	auto const frame_bytes{(positions.size() + (needs_velocities() ? velocities.size() : 0)) * sizeof(glm::vec4)};
+	{
+		auto const lock{std::scoped_lock{queue_mutex}};
+		if (queued_bytes + frame_bytes > config.memory_budget) {
+			++frames_dropped;
+			return false;
+		}
+		queued_bytes += frame_bytes;
+	}
+	// Copied outside the lock, the budget is already reserved.
+	auto f{frame{tick, time, {positions.begin(), positions.end()}, {}}};
+	if (needs_velocities()) {
+		f.velocities.assign(velocities.begin(), velocities.end());
+	}
+	{
+		auto const lock{std::scoped_lock{queue_mutex}};
+		queue.push_back(std::move(f));
+	}
+	queue_condition.notify_one();
+	return true;
+}
+
+auto trajectory_writer::stats() const -> trajectory_stats {
+	auto const lock{std::scoped_lock{queue_mutex}};
+	return trajectory_stats{
+		.frames_written = frames_written,
+		.frames_dropped = frames_dropped,
+		.bytes_written = bytes_written,
+		.queued_bytes = queued_bytes,
+		.codec = codec_totals,
+		.disk_full = disk_full,
+	};
+}
+
+auto trajectory_writer::run() -> void {
+	trace::set_thread_name("trajectory writer");
+	auto lock{std::unique_lock{queue_mutex}};
+	while (true) {
+		queue_condition.wait(lock, [this] { return stopping || !queue.empty(); });
+		if (queue.empty()) {
+			return;
+		}
+		auto f{std::move(queue.front())};
+		queue.pop_front();
+		lock.unlock();
+		if (disk_full) {
+			++frames_dropped;
+		} else if (config.compress) {
+			write_compressed(f);
+		} else {
+			write(f);
+		}
+		lock.lock();
+		queued_bytes -= f.bytes();
+		codec_totals = encoder.stats();
+	}
+}
+
+auto trajectory_writer::write(frame const& f) -> void {
+	TRACE_FUNCTION();
+	auto const decimation{static_cast<size_t>(config.decimation)};
+	auto const body_count{kept_bodies(f.positions.size(), config.decimation)};
+	scratch.clear();
+	auto const append_xyz = [&](std::vector<glm::vec4> const& source) {
+		for (size_t i{0}; i < source.size(); i += decimation) {
+			scratch.insert(scratch.end(), {source[i].x, source[i].y, source[i].z});
+		}
+	};
+	if ((config.fields & trajectory_field::positions) != 0) {
+		append_xyz(f.positions);
+	}
+	if ((config.fields & trajectory_field::velocities) != 0) {
+		append_xyz(f.velocities);
+	}
+	if ((config.fields & trajectory_field::masses) != 0) {
+		for (size_t i{0}; i < f.positions.size(); i += decimation) {
+			scratch.push_back(f.positions[i].w);
+		}
+	}
+
+	auto const chunk{trajectory_chunk_header{
+		.magic = trajectory_chunk_magic,
+		.fields = config.fields,
+		.tick = f.tick,
+		.time = f.time,
+		.body_count = body_count,
+		.payload_size = scratch.size() * sizeof(float),
+	}};
+	write_chunk(chunk, scratch.data());
+}
+
+auto trajectory_writer::write_compressed(frame const& f) -> void {
+	TRACE_FUNCTION();
+	auto positions{std::span<glm::vec4 const>{f.positions}};
+	auto velocities{std::span<glm::vec4 const>{f.velocities}};
+	if (config.decimation > 1) {
+		auto const decimate = [this](std::vector<glm::vec4> const& source, std::vector<glm::vec4>& target) {
+			target.clear();
+			for (size_t i{0}; i < source.size(); i += config.decimation) {
+				target.push_back(source[i]);
+			}
+		};
+		decimate(f.positions, decimated_positions);
+		decimate(f.velocities, decimated_velocities);
+		positions = decimated_positions;
+		velocities = decimated_velocities;
+	}
+	encoded.clear();
+	encoder.encode(positions, velocities, encoded);
+
+	auto const chunk{trajectory_chunk_header{
+		.magic = trajectory_chunk_magic,
+		.fields = config.fields | trajectory_field::compressed,
+		.tick = f.tick,
+		.time = f.time,
+		.body_count = positions.size(),
+		.payload_size = encoded.size(),
+	}};
+	write_chunk(chunk, encoded.data());
+}
+
+auto trajectory_writer::write_chunk(trajectory_chunk_header const& chunk, void const* payload) -> void {
+	if (config.disk_budget != 0 && bytes_written + sizeof(trajectory_header) + sizeof(chunk) + chunk.payload_size > config.disk_budget) {
+		disk_full = true;
+		++frames_dropped;
+		return;
+	}
+	auto const written{std::fwrite(&chunk, sizeof(chunk), 1, file) + std::fwrite(payload, 1, chunk.payload_size, file)};
+	if (written != 1 + chunk.payload_size) {
+		fmt::print(stderr, "Trajectory: failed to write frame {}\n", chunk.tick);
+		return;
+	}
+	++frames_written;
+	bytes_written += sizeof(chunk) + chunk.payload_size;
+}
+
+} // namespace gravity::io
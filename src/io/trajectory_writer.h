@@ -0,0 +1,151 @@
+#ifndef TRAJECTORY_WRITER_H
+#define TRAJECTORY_WRITER_H
+
+#include "trajectory_codec.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace gravity::io {
+
+// A trajectory file is a trajectory_header followed by one chunk per frame: a
+// trajectory_chunk_header and then float arrays for each field in the order of the
+// enum, positions and velocities as xyz triplets, masses as scalars. Chunks with the
+// compressed bit hold a frame of trajectory_codec instead.
+struct trajectory_field {
+	enum : uint32_t {
+		positions = 1 << 0,
+		velocities = 1 << 1,
+		masses = 1 << 2,
+		compressed = 1u << 31,
+	};
+};
+
+struct trajectory_header {
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t fields;
+	uint32_t interval;
+	uint32_t decimation;
+};
+
+struct trajectory_chunk_header {
+	std::array<char, 4> magic;
+	uint32_t fields;
+	uint64_t tick;
+	double time;
+	uint64_t body_count;
+	uint64_t payload_size;
+};
+
+constexpr auto trajectory_magic{std::array<char, 8>{'G', 'R', 'A', 'V', 'T', 'R', 'A', 'J'}};
+constexpr auto trajectory_chunk_magic{std::array<char, 4>{'F', 'R', 'A', 'M'}};
+constexpr uint32_t trajectory_version{2};
+
+struct trajectory_options {
+	std::filesystem::path path{};
+	// Write every interval-th tick.
+	uint32_t interval{1};
+	uint32_t fields{trajectory_field::positions | trajectory_field::velocities};
+	// Keep every decimation-th body.
+	uint32_t decimation{1};
+	// Frames that do not fit in the queue are dropped instead of slowing the simulation down.
+	size_t memory_budget{size_t{512} << 20};
+	// Recording stops once the file would grow past this, 0 for no limit.
+	uint64_t disk_budget{0};
+	bool compress{false};
+	codec_options codec{};
+};
+
+struct trajectory_stats {
+	uint64_t frames_written{0};
+	uint64_t frames_dropped{0};
+	uint64_t bytes_written{0};
+	size_t queued_bytes{0};
+	codec_stats codec{};
+	bool disk_full{false};
+};
+
+// Writes frames on a dedicated thread, submit only copies the bodies into the queue.
+class trajectory_writer {
+public:
+	// Throws std::runtime_error if the file can not be created.
+	explicit trajectory_writer(trajectory_options options);
+	~trajectory_writer();
+	trajectory_writer(trajectory_writer const&) = delete;
+	auto operator=(trajectory_writer const&) -> trajectory_writer& = delete;
+	trajectory_writer(trajectory_writer&&) = delete;
+	auto operator=(trajectory_writer&&) -> trajectory_writer& = delete;
+
+	[[nodiscard]] auto wants(uint64_t tick) const -> bool {
+		return tick % config.interval == 0;
+	}
+	[[nodiscard]] auto needs_velocities() const -> bool {
+		return (config.fields & trajectory_field::velocities) != 0;
+	}
+	[[nodiscard]] auto options() const -> trajectory_options const& {
+		return config;
+	}
+
+	// Bodies in the std430 layout of the compute shaders, velocities may be empty if they are not written.
+	// Returns false if the frame was dropped.
+	auto submit(uint64_t tick, double time, std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities) -> bool;
+	// For frames the caller could not capture, e.g. when every readback is still in flight.
+	auto drop() -> void {
+		++frames_dropped;
+	}
+	[[nodiscard]] auto stats() const -> trajectory_stats;
+
+private:
+	struct frame {
+		uint64_t tick;
+		double time;
+		std::vector<glm::vec4> positions;
+		std::vector<glm::vec4> velocities;
+
+		[[nodiscard]] auto bytes() const -> size_t {
+			return (positions.size() + velocities.size()) * sizeof(glm::vec4);
+		}
+	};
+
+	auto run() -> void;
+	auto write(frame const& f) -> void;
+	auto write_compressed(frame const& f) -> void;
+	auto write_chunk(trajectory_chunk_header const& chunk, void const* payload) -> void;
+
+	trajectory_options config;
+	std::FILE* file;
+	std::vector<float> scratch{};
+	frame_encoder encoder;
+	std::vector<std::byte> encoded{};
+	std::vector<glm::vec4> decimated_positions{};
+	std::vector<glm::vec4> decimated_velocities{};
+
+	mutable std::mutex queue_mutex{};
+	std::condition_variable queue_condition{};
+	std::deque<frame> queue{};
+	size_t queued_bytes{0};
+	codec_stats codec_totals{};
+	bool stopping{false};
+
+	std::atomic<uint64_t> frames_written{0};
+	std::atomic<uint64_t> frames_dropped{0};
+	std::atomic<uint64_t> bytes_written{0};
+	// Set on the writer thread, every later frame is dropped so compressed deltas never miss their reference.
+	std::atomic<bool> disk_full{false};
+	std::thread writer_thread{};
+};
+
+} // namespace gravity::io
+
+#endif
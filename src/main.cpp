@@ -1,18 +1,155 @@
+#include "initial_conditions.h"
+#include "program_cache.h"
 #include "render_loop.h"
 #include "world.h"
 
+#include <charconv>
+#include <cmath>
 #include <fmt/core.h>
 #include <iostream>
+#include <limits>
 #include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <stdexcept>
+#include <string_view>
+#include <trace.h>
 #include <easy/profiler.h>
 
+namespace {
+
+auto print_usage() -> void {
+	fmt::print(stderr,
+		"Usage: gravity [options]\n"
+		"  --load <file>                    start from a CSV or binary body file\n"
+		"  --convert <in.csv> <out>         write a CSV as a binary body file and exit\n"
+		"  --restore <file>                 start from a checkpoint\n"
+		"  --checkpoint <file>              save a checkpoint on exit\n"
+		"  --trace <file>                   record a Chrome or Perfetto trace\n"
+		"  --trajectory <file>              record the bodies\n"
+		"  --trajectory-every <ticks>       record every Kth tick\n"
+		"  --trajectory-decimate <D>        keep every Dth body\n"
+		"  --trajectory-fields <pvm>        record positions, velocities and/or masses\n"
+		"  --trajectory-budget <MB>         queue size before frames are dropped\n"
+		"  --trajectory-disk-budget <MB>    stop recording past this file size\n"
+		"  --trajectory-compress <error>    quantize to this fraction of the scene extent\n"
+		"  --trajectory-keyframes <K>       keyframe every K compressed frames\n"
+		"  --replay <file>                  play back a trajectory\n"
+		"  --replay-cache <MB>              decoded frames kept in memory\n"
+		"  --replay-prefetch <N>            frames decoded ahead on each side\n"
+		"  --seed <n>                       seed of the first spawned scene\n"
+		"  --cold-start                     compile every shader program from source\n");
+}
+
+// Throws std::invalid_argument naming flag if value is not a whole T.
+template <typename T>
+auto parse_number(std::string_view flag, std::string_view value) -> T {
+	auto parsed{T{}};
+	auto const [end, error]{std::from_chars(value.data(), value.data() + value.size(), parsed)};
+	if (error != std::errc{} || end != value.data() + value.size()) {
+		throw std::invalid_argument{fmt::format("{} expects a number, got '{}'", flag, value)};
+	}
+	return parsed;
+}
+
+// Returns the bytes in value megabytes, throws std::invalid_argument if they do not fit.
+auto parse_megabytes(std::string_view flag, std::string_view value) -> size_t {
+	auto const megabytes{parse_number<size_t>(flag, value)};
+	if (megabytes > (std::numeric_limits<size_t>::max() >> 20)) {
+		throw std::invalid_argument{fmt::format("{} is too large, got {} MB", flag, value)};
+	}
+	return megabytes << 20;
+}
+
+} // namespace
+
 auto main(int argc, char* argv[]) -> int {
-	(void)argc;
-	(void)argv;
 	fmt::print("Initalizing ...\n");
 	#ifdef EASY_PROFILER
 		profiler::startListen();
 	#endif
+	gravity::trace::set_thread_name("main");
+	auto const args{std::span{argv, static_cast<size_t>(argc)}};
+	char const* restore_path{nullptr};
+	char const* bodies_path{nullptr};
+	char const* checkpoint_path{nullptr};
+	auto trajectory{gravity::io::trajectory_options{}};
+	char const* replay_path{nullptr};
+	auto replay{gravity::io::timeline_options{}};
+	auto seed{std::optional<uint64_t>{}};
+	try {
+		for (size_t i{1}; i < args.size(); ++i) {
+			if (std::string_view{args[i]} == "--trace" && i + 1 < args.size()) {
+				gravity::trace::start(args[++i]);
+			} else if (std::string_view{args[i]} == "--restore" && i + 1 < args.size()) {
+				restore_path = args[++i];
+			} else if (std::string_view{args[i]} == "--load" && i + 1 < args.size()) {
+				bodies_path = args[++i];
+			} else if (std::string_view{args[i]} == "--convert" && i + 2 < args.size()) {
+				// Writes a CSV as a binary body file and exits.
+				try {
+					auto const bodies{gravity::io::initial_conditions{args[i + 1]}};
+					gravity::io::save_bodies(args[i + 2], bodies.positions(), bodies.velocities());
+					fmt::print("Wrote {} bodies to {}\n", bodies.positions().size(), args[i + 2]);
+					return 0;
+				} catch (std::runtime_error const& error) {
+					fmt::print(stderr, "{}\n", error.what());
+					return 1;
+				}
+			} else if (std::string_view{args[i]} == "--checkpoint" && i + 1 < args.size()) {
+				checkpoint_path = args[++i];
+			} else if (std::string_view{args[i]} == "--trajectory" && i + 1 < args.size()) {
+				trajectory.path = args[++i];
+			} else if (std::string_view{args[i]} == "--trajectory-every" && i + 1 < args.size()) {
+				trajectory.interval = parse_number<uint32_t>(args[i], args[i + 1]);
+				++i;
+			} else if (std::string_view{args[i]} == "--trajectory-decimate" && i + 1 < args.size()) {
+				trajectory.decimation = parse_number<uint32_t>(args[i], args[i + 1]);
+				++i;
+			} else if (std::string_view{args[i]} == "--trajectory-budget" && i + 1 < args.size()) {
+				trajectory.memory_budget = parse_megabytes(args[i], args[i + 1]);
+				++i;
+			} else if (std::string_view{args[i]} == "--trajectory-disk-budget" && i + 1 < args.size()) {
+				trajectory.disk_budget = parse_megabytes(args[i], args[i + 1]);
+				++i;
+			} else if (std::string_view{args[i]} == "--trajectory-compress" && i + 1 < args.size()) {
+				trajectory.compress = true;
+				trajectory.codec.relative_error = parse_number<double>(args[i], args[i + 1]);
+				if (!std::isfinite(trajectory.codec.relative_error) || trajectory.codec.relative_error <= 0.0) {
+					throw std::invalid_argument{fmt::format("{} expects a positive error, got '{}'", args[i], args[i + 1])};
+				}
+				++i;
+			} else if (std::string_view{args[i]} == "--trajectory-keyframes" && i + 1 < args.size()) {
+				trajectory.codec.keyframe_interval = parse_number<uint32_t>(args[i], args[i + 1]);
+				++i;
+			} else if (std::string_view{args[i]} == "--trajectory-fields" && i + 1 < args.size()) {
+				// Any of p(ositions), v(elocities) and m(asses).
+				auto const fields{std::string_view{args[++i]}};
+				trajectory.fields = (fields.find('p') != std::string_view::npos ? gravity::io::trajectory_field::positions : 0u)
+					| (fields.find('v') != std::string_view::npos ? gravity::io::trajectory_field::velocities : 0u)
+					| (fields.find('m') != std::string_view::npos ? gravity::io::trajectory_field::masses : 0u);
+			} else if (std::string_view{args[i]} == "--replay" && i + 1 < args.size()) {
+				replay_path = args[++i];
+			} else if (std::string_view{args[i]} == "--seed" && i + 1 < args.size()) {
+				seed = parse_number<uint64_t>(args[i], args[i + 1]);
+				++i;
+			} else if (std::string_view{args[i]} == "--cold-start") {
+				// Compiles every program from source, to measure startup without the binary cache.
+				gravity::gl::ignore_cached_programs();
+			} else if (std::string_view{args[i]} == "--replay-cache" && i + 1 < args.size()) {
+				replay.cache_budget = parse_megabytes(args[i], args[i + 1]);
+				++i;
+			} else if (std::string_view{args[i]} == "--replay-prefetch" && i + 1 < args.size()) {
+				replay.prefetch_radius = parse_number<uint32_t>(args[i], args[i + 1]);
+				++i;
+			}
+		}
+	} catch (std::invalid_argument const& error) {
+		fmt::print(stderr, "{}\n", error.what());
+		print_usage();
+		return 1;
+	}
 	gravity::renderer_options options{144.0, 60};
 
 
@@ -21,7 +158,34 @@ auto main(int argc, char* argv[]) -> int {
 		return 1;
 	}
 
-	gravity::renderer renderer{};
-	gravity::world world{};
-	return loop.start(world, renderer);
+	gravity::renderer renderer{loop.compiler()};
+	gravity::world world{seed};
+	try {
+		if (bodies_path != nullptr) {
+			world.load_initial_conditions(bodies_path);
+		}
+		if (restore_path != nullptr) {
+			world.load_checkpoint(restore_path);
+		}
+		if (replay_path != nullptr) {
+			world.open_replay(replay_path, replay);
+		}
+		if (!trajectory.path.empty()) {
+			world.record_trajectory(trajectory);
+		}
+	} catch (std::runtime_error const& error) {
+		fmt::print(stderr, "{}\n", error.what());
+		return 1;
+	}
+	auto const result{loop.start(world, renderer)};
+	try {
+		if (checkpoint_path != nullptr) {
+			world.save_checkpoint(checkpoint_path);
+		}
+	} catch (std::runtime_error const& error) {
+		fmt::print(stderr, "{}\n", error.what());
+	}
+	world.print_report(stdout);
+	gravity::trace::stop();
+	return result;
 }
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "gpu_timer.h"
+
+#include <algorithm>
+
+namespace gravity::profiling {
+
+namespace {
+constexpr uint64_t calibration_interval{1'000'000'000};
+}
+
+gpu_timer::gpu_timer()
+	: track{trace::register_track("GPU")} {}
+
+gpu_timer::~gpu_timer() {
+	for (auto const& pair : in_flight) {
+		free_queries.push_back(pair.begin_query);
+		free_queries.push_back(pair.end_query);
+	}
+	if (!free_queries.empty()) {
+		glDeleteQueries(static_cast<GLsizei>(free_queries.size()), free_queries.data());
+	}
+}
+
+auto gpu_timer::acquire_query() -> GLuint {
+	if (free_queries.empty()) {
+		GLuint query;
+		glGenQueries(1, &query);
+		return query;
+	}
+	auto const query{free_queries.back()};
+	free_queries.pop_back();
+	return query;
+}
+
+auto gpu_timer::calibrate() -> void {
+	GLint64 gpu_time;
+	glGetInteger64v(GL_TIMESTAMP, &gpu_time);
+	last_calibration = trace::now();
+	clock_offset = static_cast<int64_t>(gpu_time) - static_cast<int64_t>(last_calibration);
+}
+
+auto gpu_timer::begin(char const* name, uint64_t payload) -> void {
+	auto& pair{in_flight.emplace_back(query_pair{name, payload, acquire_query(), acquire_query(), false})};
+	glQueryCounter(pair.begin_query, GL_TIMESTAMP);
+	open.push_back(in_flight.size() - 1);
+}
+
+auto gpu_timer::end() -> void {
+	if (open.empty()) {
+		return;
+	}
+	auto const index{open.back()};
+	open.pop_back();
+	auto& pair{in_flight[index]};
+	glQueryCounter(pair.end_query, GL_TIMESTAMP);
+	pair.ended = true;
+}
+
+auto gpu_timer::collect() -> std::span<gpu_sample const> {
+	resolved.clear();
+	auto const tracing{trace::enabled()};
+	if (tracing && (last_calibration == 0 || trace::now() - last_calibration > calibration_interval)) {
+		calibrate();
+	}
+	// Scopes that are still open hold indices into in_flight.
+	if (!open.empty()) {
+		return resolved;
+	}
+	while (!in_flight.empty() && in_flight.front().ended) {
+		auto const& pair{in_flight.front()};
+		GLint available{GL_FALSE};
+		glGetQueryObjectiv(pair.end_query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_FALSE) {
+			break;
+		}
+		GLuint64 begin_time;
+		GLuint64 end_time;
+		glGetQueryObjectui64v(pair.begin_query, GL_QUERY_RESULT, &begin_time);
+		glGetQueryObjectui64v(pair.end_query, GL_QUERY_RESULT, &end_time);
+		resolved.push_back(gpu_sample{pair.name, pair.payload, static_cast<double>(end_time - begin_time) * 1e-9});
+		if (tracing) {
+			auto const to_trace_time = [this](GLuint64 gpu_time) { return static_cast<uint64_t>(std::max(int64_t{0}, static_cast<int64_t>(gpu_time) - clock_offset)); };
+			trace::complete(track, pair.name, to_trace_time(begin_time), to_trace_time(end_time));
+		}
+
+		free_queries.push_back(pair.begin_query);
+		free_queries.push_back(pair.end_query);
+		in_flight.pop_front();
+	}
+	return resolved;
+}
+
+} // namespace gravity::profiling
@@ -0,0 +1,80 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include "opengl.h"
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <trace.h>
+#include <vector>
+
+namespace gravity::profiling {
+
+struct gpu_sample {
+	char const* name;
+	uint64_t payload;
+	double seconds;
+};
+
+// Measures GPU work with timestamp queries, the durations are handed back from collect()
+// and put on a "GPU" track of the trace. Queries are resolved a few frames late so
+// nothing ever waits on the GPU.
+class gpu_timer {
+public:
+	gpu_timer();
+	~gpu_timer();
+	gpu_timer(gpu_timer const&) = delete;
+	auto operator=(gpu_timer const&) -> gpu_timer& = delete;
+	gpu_timer(gpu_timer&&) = delete;
+	auto operator=(gpu_timer&&) -> gpu_timer& = delete;
+
+	// payload is handed back with the sample, e.g. the amount of work that was timed.
+	auto begin(char const* name, uint64_t payload = 0) -> void;
+	auto end() -> void;
+	// Call once per frame, returns the scopes that finished on the GPU since the last call.
+	auto collect() -> std::span<gpu_sample const>;
+
+private:
+	struct query_pair {
+		char const* name;
+		uint64_t payload;
+		GLuint begin_query;
+		GLuint end_query;
+		bool ended;
+	};
+
+	auto acquire_query() -> GLuint;
+	auto calibrate() -> void;
+
+	std::deque<query_pair> in_flight{};
+	std::vector<size_t> open{};
+	std::vector<GLuint> free_queries{};
+	std::vector<gpu_sample> resolved{};
+	trace::track_id track;
+	// GPU timestamp minus trace timestamp.
+	int64_t clock_offset{0};
+	uint64_t last_calibration{0};
+};
+
+class gpu_scope {
+public:
+	gpu_scope(gpu_timer& timer, char const* name)
+		: timer{timer} {
+		timer.begin(name);
+	}
+	~gpu_scope() {
+		timer.end();
+	}
+	gpu_scope(gpu_scope const&) = delete;
+	auto operator=(gpu_scope const&) -> gpu_scope& = delete;
+	gpu_scope(gpu_scope&&) = delete;
+	auto operator=(gpu_scope&&) -> gpu_scope& = delete;
+
+private:
+	gpu_timer& timer;
+};
+
+} // namespace gravity::profiling
+
+#endif
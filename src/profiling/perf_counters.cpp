@@ -0,0 +1,235 @@
+#include "perf_counters.h"
+
+#include <fmt/core.h>
+#include <imgui.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace gravity::profiling {
+
+namespace {
+
+constexpr auto counter_count{static_cast<size_t>(hardware_counter::count)};
+constexpr auto stage_count{static_cast<size_t>(stage::count)};
+constexpr auto counter_names{std::array<std::string_view, counter_count>{"cycles", "instructions", "L1D misses", "LLC misses", "branch misses"}};
+
+#ifdef __linux__
+auto open_counter(uint32_t type, uint64_t config, int group) -> int {
+	perf_event_attr attributes{};
+	attributes.size = sizeof(perf_event_attr);
+	attributes.type = type;
+	attributes.config = config;
+	attributes.disabled = group == -1 ? 1 : 0;
+	attributes.exclude_kernel = 1;
+	attributes.exclude_hv = 1;
+	attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, group, 0));
+}
+
+constexpr auto cache_config(uint64_t cache, uint64_t operation, uint64_t result) -> uint64_t {
+	return cache | (operation << 8) | (result << 16);
+}
+#endif
+
+} // namespace
+
+auto stage_name(stage s) -> std::string_view {
+	switch (s) {
+		case stage::force: return "Force";
+		case stage::integration: return "Integration";
+		case stage::tree_build: return "Tree build";
+		case stage::upload: return "Upload";
+		case stage::count: break;
+	}
+	return "Unknown";
+}
+
+auto counter_totals::instructions_per_cycle() const -> double {
+	auto const cycles{(*this)[hardware_counter::cycles]};
+	return cycles == 0 ? 0.0 : static_cast<double>((*this)[hardware_counter::instructions]) / static_cast<double>(cycles);
+}
+
+auto counter_totals::interactions_per_cycle() const -> double {
+	auto const cycles{(*this)[hardware_counter::cycles]};
+	return cycles == 0 ? 0.0 : static_cast<double>(interactions) / static_cast<double>(cycles);
+}
+
+auto counter_totals::per_kilo_instruction(hardware_counter counter) const -> double {
+	auto const instructions{(*this)[hardware_counter::instructions]};
+	return instructions == 0 ? 0.0 : 1000.0 * static_cast<double>((*this)[counter]) / static_cast<double>(instructions);
+}
+
+perf_counters::perf_counters() {
+	fds.fill(-1);
+	read_index.fill(-1);
+#ifdef __linux__
+	struct event_config {
+		hardware_counter counter;
+		uint32_t type;
+		uint64_t config;
+	};
+	auto const events{std::array<event_config, counter_count>{{
+		{hardware_counter::cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+		{hardware_counter::instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+		{hardware_counter::l1d_misses, PERF_TYPE_HW_CACHE, cache_config(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+		{hardware_counter::llc_misses, PERF_TYPE_HW_CACHE, cache_config(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+		{hardware_counter::branch_misses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	}}};
+
+	// Cycles lead the group, the rest is optional since not every PMU (or VM) exposes them.
+	for (auto const& event : events) {
+		auto const index{static_cast<size_t>(event.counter)};
+		auto const fd{open_counter(event.type, event.config, group_fd)};
+		if (fd == -1) {
+			if (group_fd == -1) {
+				fmt::print(stderr, "Hardware performance counters are not available (perf_event_paranoid?)\n");
+				return;
+			}
+			fmt::print(stderr, "Hardware counter {} is not available\n", counter_names[index]);
+			continue;
+		}
+		if (group_fd == -1) {
+			group_fd = fd;
+		}
+		fds[index] = fd;
+		read_index[index] = static_cast<int>(opened++);
+	}
+	ioctl(group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+perf_counters::~perf_counters() {
+#ifdef __linux__
+	for (auto const fd : fds) {
+		if (fd != -1) {
+			close(fd);
+		}
+	}
+#endif
+}
+
+auto perf_counters::read(snapshot& values) const -> bool {
+#ifdef __linux__
+	// Layout of a PERF_FORMAT_GROUP read: nr, time_enabled, time_running, value[nr]
+	auto buffer{std::array<uint64_t, 3 + counter_count>{}};
+	auto const bytes{::read(group_fd, buffer.data(), sizeof(buffer))};
+	if (bytes < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+		return false;
+	}
+	auto const time_enabled{buffer[1]};
+	auto const time_running{buffer[2]};
+	// Scale if the group was multiplexed with other users of the PMU.
+	auto const scale{time_running == 0 ? 0.0 : static_cast<double>(time_enabled) / static_cast<double>(time_running)};
+	for (size_t i{0}; i < counter_count; ++i) {
+		values[i] = read_index[i] == -1 ? 0 : static_cast<uint64_t>(static_cast<double>(buffer[3 + static_cast<size_t>(read_index[i])]) * scale);
+	}
+	return true;
+#else
+	(void)values;
+	return false;
+#endif
+}
+
+auto perf_counters::begin(stage s) -> void {
+	if (!available()) {
+		return;
+	}
+	read(stage_start[static_cast<size_t>(s)]);
+}
+
+auto perf_counters::end(stage s) -> void {
+	if (!available()) {
+		return;
+	}
+	auto values{snapshot{}};
+	if (!read(values)) {
+		return;
+	}
+	auto const index{static_cast<size_t>(s)};
+	auto& totals{stage_totals[index]};
+	for (size_t i{0}; i < counter_count; ++i) {
+		totals.values[i] += values[i] - stage_start[index][i];
+	}
+	++totals.samples;
+}
+
+auto perf_counters::add_interactions(stage s, uint64_t interactions) -> void {
+	stage_totals[static_cast<size_t>(s)].interactions += interactions;
+}
+
+auto perf_counters::reset() -> void {
+	stage_totals.fill(counter_totals{});
+}
+
+auto perf_counters::show_stats() const -> void {
+	if (!available()) {
+		ImGui::TextUnformatted("Hardware counters are not available");
+		return;
+	}
+	constexpr auto flags{ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg};
+	if (!ImGui::BeginTable("Hardware counters", 7, flags)) {
+		return;
+	}
+	ImGui::TableSetupColumn("Stage");
+	ImGui::TableSetupColumn("Mcycles/tick");
+	ImGui::TableSetupColumn("IPC");
+	ImGui::TableSetupColumn("L1D MPKI");
+	ImGui::TableSetupColumn("LLC MPKI");
+	ImGui::TableSetupColumn("Branch MPKI");
+	ImGui::TableSetupColumn("Interactions/cycle");
+	ImGui::TableHeadersRow();
+	for (size_t i{0}; i < stage_count; ++i) {
+		auto const& totals{stage_totals[i]};
+		if (totals.samples == 0) {
+			continue;
+		}
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::TextUnformatted(stage_name(static_cast<stage>(i)).data());
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", static_cast<double>(totals[hardware_counter::cycles]) / static_cast<double>(totals.samples) / 1e6);
+		ImGui::TableNextColumn();
+		ImGui::Text("%.2f", totals.instructions_per_cycle());
+		ImGui::TableNextColumn();
+		ImGui::Text("%.2f", totals.per_kilo_instruction(hardware_counter::l1d_misses));
+		ImGui::TableNextColumn();
+		ImGui::Text("%.2f", totals.per_kilo_instruction(hardware_counter::llc_misses));
+		ImGui::TableNextColumn();
+		ImGui::Text("%.2f", totals.per_kilo_instruction(hardware_counter::branch_misses));
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", totals.interactions_per_cycle());
+	}
+	ImGui::EndTable();
+}
+
+auto perf_counters::print_report(std::FILE* out) const -> void {
+	if (!available()) {
+		return;
+	}
+	fmt::print(out, "{:<12} {:>8} {:>14} {:>14} {:>6} {:>9} {:>9} {:>11} {:>13}\n", "Stage", "Ticks", "Cycles", "Instructions", "IPC", "L1D MPKI", "LLC MPKI", "Branch MPKI", "Inter./cycle");
+	for (size_t i{0}; i < stage_count; ++i) {
+		auto const& totals{stage_totals[i]};
+		if (totals.samples == 0) {
+			continue;
+		}
+		fmt::print(out,
+			"{:<12} {:>8} {:>14} {:>14} {:>6.2f} {:>9.2f} {:>9.2f} {:>11.2f} {:>13.3f}\n",
+			stage_name(static_cast<stage>(i)),
+			totals.samples,
+			totals[hardware_counter::cycles],
+			totals[hardware_counter::instructions],
+			totals.instructions_per_cycle(),
+			totals.per_kilo_instruction(hardware_counter::l1d_misses),
+			totals.per_kilo_instruction(hardware_counter::llc_misses),
+			totals.per_kilo_instruction(hardware_counter::branch_misses),
+			totals.interactions_per_cycle());
+	}
+}
+
+} // namespace gravity::profiling
@@ -0,0 +1,108 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+namespace gravity::profiling {
+
+// Phases of a simulation tick that hardware counters are attributed to.
+enum class stage : size_t {
+	force,
+	integration,
+	tree_build,
+	upload,
+	count,
+};
+
+[[nodiscard]] auto stage_name(stage s) -> std::string_view;
+
+enum class hardware_counter : size_t {
+	cycles,
+	instructions,
+	l1d_misses,
+	llc_misses,
+	branch_misses,
+	count,
+};
+
+struct counter_totals {
+	std::array<uint64_t, static_cast<size_t>(hardware_counter::count)> values{};
+	uint64_t samples{0};
+	uint64_t interactions{0};
+
+	[[nodiscard]] auto operator[](hardware_counter counter) const -> uint64_t {
+		return values[static_cast<size_t>(counter)];
+	}
+	[[nodiscard]] auto instructions_per_cycle() const -> double;
+	[[nodiscard]] auto interactions_per_cycle() const -> double;
+	// Misses per thousand instructions.
+	[[nodiscard]] auto per_kilo_instruction(hardware_counter counter) const -> double;
+};
+
+// Per stage hardware counters read with perf_event_open on Linux, on other
+// platforms or without permission (see /proc/sys/kernel/perf_event_paranoid) every call is a no-op.
+class perf_counters {
+public:
+	perf_counters();
+	~perf_counters();
+	perf_counters(perf_counters const&) = delete;
+	auto operator=(perf_counters const&) -> perf_counters& = delete;
+	perf_counters(perf_counters&&) = delete;
+	auto operator=(perf_counters&&) -> perf_counters& = delete;
+
+	[[nodiscard]] auto available() const -> bool {
+		return group_fd != -1;
+	}
+
+	auto begin(stage s) -> void;
+	auto end(stage s) -> void;
+	auto add_interactions(stage s, uint64_t interactions) -> void;
+	auto reset() -> void;
+
+	[[nodiscard]] auto totals(stage s) const -> counter_totals const& {
+		return stage_totals[static_cast<size_t>(s)];
+	}
+
+	// Draws the counter table into the current ImGui window.
+	auto show_stats() const -> void;
+	auto print_report(std::FILE* out) const -> void;
+
+private:
+	using snapshot = std::array<uint64_t, static_cast<size_t>(hardware_counter::count)>;
+	auto read(snapshot& values) const -> bool;
+
+	int group_fd{-1};
+	std::array<int, static_cast<size_t>(hardware_counter::count)> fds{};
+	// Position of each counter in the group read, or -1 if the event could not be opened.
+	std::array<int, static_cast<size_t>(hardware_counter::count)> read_index{};
+	size_t opened{0};
+	std::array<snapshot, static_cast<size_t>(stage::count)> stage_start{};
+	std::array<counter_totals, static_cast<size_t>(stage::count)> stage_totals{};
+};
+
+class perf_scope {
+public:
+	perf_scope(perf_counters& counters, stage s)
+		: counters{counters}
+		, s{s} {
+		counters.begin(s);
+	}
+	~perf_scope() {
+		counters.end(s);
+	}
+	perf_scope(perf_scope const&) = delete;
+	auto operator=(perf_scope const&) -> perf_scope& = delete;
+	perf_scope(perf_scope&&) = delete;
+	auto operator=(perf_scope&&) -> perf_scope& = delete;
+
+private:
+	perf_counters& counters;
+	stage s;
+};
+
+} // namespace gravity::profiling
+
+#endif
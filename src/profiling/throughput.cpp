@@ -0,0 +1,97 @@
+#include "throughput.h"
+
+#include <fmt/core.h>
+#include <imgui.h>
+
+namespace gravity::profiling {
+
+namespace {
+constexpr double giga{1e9};
+constexpr auto window_length{std::chrono::seconds{1}};
+
+auto fraction_of(double achieved, double peak) -> double {
+	return peak > 0.0 ? 100.0 * achieved / peak : 0.0;
+}
+} // namespace
+
+auto throughput_totals::add(throughput_totals const& other) -> void {
+	ticks += other.ticks;
+	interactions += other.interactions;
+	flops += other.flops;
+	bytes += other.bytes;
+	kernel_seconds += other.kernel_seconds;
+}
+
+auto throughput_totals::gflops() const -> double {
+	return kernel_seconds > 0.0 ? flops / kernel_seconds / giga : 0.0;
+}
+
+auto throughput_totals::bandwidth_gbs() const -> double {
+	return kernel_seconds > 0.0 ? bytes / kernel_seconds / giga : 0.0;
+}
+
+throughput::throughput(solver_cost cost)
+	: cost{cost} {}
+
+auto throughput::record_tick(uint64_t bodies, double kernel_seconds) -> void {
+	auto const interactions{bodies == 0 ? 0 : bodies * (bodies - 1)};
+	auto const tick{throughput_totals{
+		.ticks = 1,
+		.interactions = interactions,
+		.flops = static_cast<double>(interactions) * cost.flops_per_interaction,
+		.bytes = static_cast<double>(interactions) * cost.bytes_per_interaction + static_cast<double>(bodies) * cost.bytes_per_body,
+		.kernel_seconds = kernel_seconds,
+	}};
+	last_bodies = bodies;
+	last_interactions = interactions;
+	run.add(tick);
+
+	auto const now{wall_clock::now()};
+	if (window.ticks == 0 && shown.ticks == 0) {
+		window_start = now;
+	}
+	window.add(tick);
+	if (now - window_start >= window_length) {
+		shown = window;
+		shown_wall_seconds = std::chrono::duration<double>(now - window_start).count();
+		window = throughput_totals{};
+		window_start = now;
+	}
+}
+
+auto throughput::show_stats() -> void {
+	ImGui::Text("%s", cost.name);
+	ImGui::Text("Bodies: %llu, interactions/tick: %.3e", static_cast<unsigned long long>(last_bodies), static_cast<double>(last_interactions));
+	if (shown.ticks == 0) {
+		ImGui::TextUnformatted("Waiting for a full second of ticks");
+	} else {
+		auto const interactions{static_cast<double>(shown.interactions)};
+		ImGui::Text("Ticks/s: %.1f, solver time/tick: %.3f ms", static_cast<double>(shown.ticks) / shown_wall_seconds, 1e3 * shown.kernel_seconds / static_cast<double>(shown.ticks));
+		ImGui::Text("Interactions/s: %.3e wall, %.3e in solver", interactions / shown_wall_seconds, shown.kernel_seconds > 0.0 ? interactions / shown.kernel_seconds : 0.0);
+		ImGui::Text("GFLOP/s: %.1f (%.1f%% of peak)", shown.gflops(), fraction_of(shown.gflops(), cost.peak_gflops));
+		ImGui::Text("GB/s: %.1f (%.1f%% of peak)", shown.bandwidth_gbs(), fraction_of(shown.bandwidth_gbs(), cost.peak_bandwidth_gbs));
+	}
+	ImGui::PushID(cost.name);
+	ImGui::InputDouble("Peak GFLOP/s", &cost.peak_gflops, 0.0, 0.0, "%.1f");
+	ImGui::InputDouble("Peak GB/s", &cost.peak_bandwidth_gbs, 0.0, 0.0, "%.1f");
+	ImGui::PopID();
+}
+
+auto throughput::print_summary(std::FILE* out) const -> void {
+	if (run.ticks == 0) {
+		return;
+	}
+	auto const interactions{static_cast<double>(run.interactions)};
+	fmt::print(out, "{}: {} ticks, {:.3e} interactions in {:.3f} s of solver time\n", cost.name, run.ticks, interactions, run.kernel_seconds);
+	fmt::print(out,
+		"  {:.3e} interactions/s, {:.1f} GFLOP/s ({:.1f}% of {:.0f}), {:.1f} GB/s ({:.1f}% of {:.0f})\n",
+		run.kernel_seconds > 0.0 ? interactions / run.kernel_seconds : 0.0,
+		run.gflops(),
+		fraction_of(run.gflops(), cost.peak_gflops),
+		cost.peak_gflops,
+		run.bandwidth_gbs(),
+		fraction_of(run.bandwidth_gbs(), cost.peak_bandwidth_gbs),
+		cost.peak_bandwidth_gbs);
+}
+
+} // namespace gravity::profiling
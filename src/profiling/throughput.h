@@ -0,0 +1,71 @@
+#ifndef THROUGHPUT_H
+#define THROUGHPUT_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace gravity::profiling {
+
+// Cost model of one gravity solver, used to turn pair interactions into flops and bytes.
+struct solver_cost {
+	char const* name;
+	// Counting sqrt and division as one flop each, as is customary for n-body kernels.
+	double flops_per_interaction;
+	// Bytes loaded per pair, assuming the other body is not reused from cache.
+	double bytes_per_interaction;
+	// Bytes read and written per body and tick outside the pair loop.
+	double bytes_per_body;
+	// Theoretical peaks of the device, editable in the Stats window.
+	double peak_gflops;
+	double peak_bandwidth_gbs;
+};
+
+struct throughput_totals {
+	uint64_t ticks{0};
+	uint64_t interactions{0};
+	double flops{0.0};
+	double bytes{0.0};
+	// Time spent in the solver, as opposed to wall time.
+	double kernel_seconds{0.0};
+
+	auto add(throughput_totals const& other) -> void;
+	[[nodiscard]] auto gflops() const -> double;
+	[[nodiscard]] auto bandwidth_gbs() const -> double;
+};
+
+// Interactions, flops and bytes per tick of one solver, with rates over the last second and the whole run.
+class throughput {
+public:
+	explicit throughput(solver_cost cost);
+
+	auto record_tick(uint64_t bodies, double kernel_seconds) -> void;
+
+	[[nodiscard]] auto name() const -> char const* {
+		return cost.name;
+	}
+	[[nodiscard]] auto totals() const -> throughput_totals const& {
+		return run;
+	}
+
+	// Draws into the current ImGui window.
+	auto show_stats() -> void;
+	auto print_summary(std::FILE* out) const -> void;
+
+private:
+	using wall_clock = std::chrono::steady_clock;
+
+	solver_cost cost;
+	uint64_t last_bodies{0};
+	uint64_t last_interactions{0};
+	throughput_totals run{};
+	throughput_totals window{};
+	// Rates of the last completed window.
+	throughput_totals shown{};
+	double shown_wall_seconds{0.0};
+	wall_clock::time_point window_start{wall_clock::now()};
+};
+
+} // namespace gravity::profiling
+
+#endif
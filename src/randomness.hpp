@@ -2,6 +2,9 @@
 #define RANDOMNESS_H
 
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <random>
 #include <numbers>
 #include <cmath>
@@ -20,6 +23,168 @@ template <typename T, class Generator>
     auto const pos{glm::normalize(glm::vec3{std::sin(phi) * std::cos(theta), std::sin(phi) * std::sin(theta), std::cos(phi)})};
     return pos * radius;
 }
+
+// Counter based generator, Philox4x32-10 from "Parallel random numbers: as easy as 1, 2, 3"
+// (Salmon et al. 2011). The numbers only depend on the seed, the stream and how many were drawn,
+// so body i drawing from philox{seed, i} gets the same sample on whichever thread it runs.
+class philox {
+public:
+	using result_type = uint32_t;
+	using counter_type = std::array<uint32_t, 4>;
+	using key_type = std::array<uint32_t, 2>;
+
+	constexpr philox(uint64_t seed, uint64_t stream)
+		: key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)}
+		, counter{0, 0, static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)} {}
+
+	[[nodiscard]] static constexpr auto min() -> result_type {
+		return 0;
+	}
+	[[nodiscard]] static constexpr auto max() -> result_type {
+		return UINT32_MAX;
+	}
+
+	constexpr auto operator()() -> result_type {
+		if (used == block.size()) {
+			block = generate(counter, key);
+			used = 0;
+			if (++counter[0] == 0) {
+				++counter[1];
+			}
+		}
+		return block[used++];
+	}
+
+	[[nodiscard]] static constexpr auto generate(counter_type counter, key_type key) -> counter_type {
+		constexpr uint64_t multiplier_0{0xD2511F53};
+		constexpr uint64_t multiplier_1{0xCD9E8D57};
+		constexpr uint32_t weyl_0{0x9E3779B9};
+		constexpr uint32_t weyl_1{0xBB67AE85};
+		for (int round{0}; round < 10; ++round) {
+			auto const product_0{multiplier_0 * counter[0]};
+			auto const product_1{multiplier_1 * counter[2]};
+			counter = {
+				static_cast<uint32_t>(product_1 >> 32) ^ counter[1] ^ key[0],
+				static_cast<uint32_t>(product_1),
+				static_cast<uint32_t>(product_0 >> 32) ^ counter[3] ^ key[1],
+				static_cast<uint32_t>(product_0),
+			};
+			key[0] += weyl_0;
+			key[1] += weyl_1;
+		}
+		return counter;
+	}
+
+private:
+	key_type key;
+	counter_type counter;
+	counter_type block{};
+	size_t used{block.size()};
+};
+
+static_assert(philox::generate({0, 0, 0, 0}, {0, 0}) == philox::counter_type{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}, "Philox4x32-10 known answer");
+
+// The samplers below only use these instead of the std distributions, whose output differs between standard libraries.
+
+// In (0, 1], safe to take the log of.
+template <class Generator>
+[[nodiscard]] auto unit_interval(Generator& engine) -> double {
+	return (static_cast<double>(engine() >> 8) + 1.0) * 0x1p-24;
+}
+
+template <class Generator>
+[[nodiscard]] auto normal(Generator& engine) -> double {
+	auto const radius{std::sqrt(-2.0 * std::log(unit_interval(engine)))};
+	return radius * std::cos(2.0 * std::numbers::pi * unit_interval(engine));
+}
+
+template <class Generator>
+[[nodiscard]] auto unit_vector(Generator& engine) -> glm::dvec3 {
+	auto const cos_theta{2.0 * unit_interval(engine) - 1.0};
+	auto const sin_theta{std::sqrt(std::max(0.0, 1.0 - cos_theta * cos_theta))};
+	auto const phi{2.0 * std::numbers::pi * unit_interval(engine)};
+	return {sin_theta * std::cos(phi), cos_theta, sin_theta * std::sin(phi)};
+}
+
+struct phase_point {
+	glm::vec3 position;
+	glm::vec3 velocity;
+};
+
+// Isotropic Plummer sphere in equilibrium (Aarseth, Henon & Wielen 1974), truncated at max_radius scale radii.
+template <class Generator>
+[[nodiscard]] auto plummer(Generator& engine, double scale_radius, double total_mass, double gravity_constant, double max_radius) -> phase_point {
+	auto radius{0.0};
+	do {
+		radius = 1.0 / std::sqrt(std::pow(unit_interval(engine), -2.0 / 3.0) - 1.0);
+	} while (!(radius <= max_radius));
+
+	// Speed as a fraction of the escape speed by rejection from q^2 (1 - q^2)^(7/2).
+	auto q{0.0};
+	do {
+		q = unit_interval(engine);
+	} while (0.1 * unit_interval(engine) > q * q * std::pow(1.0 - q * q, 3.5));
+	auto const escape_speed{std::sqrt(2.0 * gravity_constant * total_mass / scale_radius) * std::pow(1.0 + radius * radius, -0.25)};
+	return {
+		glm::vec3{unit_vector(engine) * (radius * scale_radius)},
+		glm::vec3{unit_vector(engine) * (q * escape_speed)},
+	};
+}
+
+// Isotropic Hernquist (1990) halo, truncated at max_radius scale radii. Velocities are drawn from a
+// Gaussian with the radial dispersion of the Jeans equation, bound to stay below the escape speed.
+template <class Generator>
+[[nodiscard]] auto hernquist(Generator& engine, double scale_radius, double total_mass, double gravity_constant, double max_radius) -> phase_point {
+	// Inverse of the enclosed mass fraction r^2 / (r + 1)^2, in scale radii.
+	auto radius{0.0};
+	do {
+		auto const root{std::sqrt(unit_interval(engine))};
+		radius = root < 1.0 ? root / (1.0 - root) : max_radius + 1.0;
+	} while (!(radius <= max_radius));
+
+	auto const r{radius};
+	// The closed form cancels catastrophically far out, where its series in 1 / r takes over.
+	auto const x{1.0 / r};
+	auto const jeans{r < 50.0
+			? 12.0 * r * std::pow(r + 1.0, 3.0) * std::log((r + 1.0) / r) - r / (r + 1.0) * (25.0 + 52.0 * r + 42.0 * r * r + 12.0 * r * r * r)
+			: x * (12.0 / 5.0 + x * (-14.0 / 5.0 + x * (102.0 / 35.0 + x * (-207.0 / 70.0 + x * (125.0 / 42.0 + x * (-209.0 / 70.0))))))};
+	auto const dispersion_squared{gravity_constant * total_mass / (12.0 * scale_radius) * jeans};
+	auto const dispersion{std::sqrt(std::max(dispersion_squared, 0.0))};
+	auto const escape_speed{std::sqrt(2.0 * gravity_constant * total_mass / (scale_radius * (r + 1.0)))};
+	auto velocity{glm::dvec3{}};
+	constexpr int max_attempts{64};
+	for (int attempt{0}; attempt < max_attempts; ++attempt) {
+		velocity = glm::dvec3{normal(engine), normal(engine), normal(engine)} * dispersion;
+		if (glm::length(velocity) < 0.95 * escape_speed) {
+			break;
+		}
+	}
+	return {glm::vec3{unit_vector(engine) * (radius * scale_radius)}, glm::vec3{velocity}};
+}
+
+// Exponential disk in the xz plane with a sech^2 vertical profile, on circular orbits around the
+// enclosed disk mass plus central_mass, turning the same way as the asteroid belt.
+template <class Generator>
+[[nodiscard]] auto exponential_disk(Generator& engine, double scale_length, double scale_height, double disk_mass, double central_mass, double gravity_constant, double max_radius) -> phase_point {
+	// The radial density R exp(-R) is a Gamma(2) distribution.
+	auto radius{0.0};
+	do {
+		radius = -std::log(unit_interval(engine) * unit_interval(engine));
+	} while (!(radius > 0.0 && radius <= max_radius));
+	auto const height{scale_height * std::atanh(std::clamp(2.0 * unit_interval(engine) - 1.0, -0.999999, 0.999999))};
+	auto const angle{2.0 * std::numbers::pi * unit_interval(engine)};
+	auto const direction{glm::dvec3{std::cos(angle), 0.0, std::sin(angle)}};
+
+	auto const enclosed_mass{disk_mass * (1.0 - (1.0 + radius) * std::exp(-radius)) + central_mass};
+	auto const distance{radius * scale_length};
+	auto const speed{std::sqrt(gravity_constant * enclosed_mass / distance)};
+	auto const tangent{glm::dvec3{direction.z, 0.0, -direction.x}};
+	return {
+		glm::vec3{direction * distance + glm::dvec3{0.0, height, 0.0}},
+		glm::vec3{tangent * speed},
+	};
+}
+
 } // namespace gravity::random
 
 #endif
\ No newline at end of file
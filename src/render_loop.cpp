@@ -1,5 +1,8 @@
 #include "render_loop.h"
 
+#include "gl_resources.h"
+#include "gl_state.h"
+#include "program_cache.h"
 #include "renderer.h"
 
 #include <cstdio>
@@ -8,6 +11,7 @@
 #include <imgui_impl_opengl3.h>
 #include <imgui_impl_sdl.h>
 #include <easy/profiler.h>
+#include <trace.h>
 
 namespace gravity {
 
@@ -22,6 +26,12 @@ render_loop::render_loop(renderer_options const options)
 }
 
 render_loop::~render_loop() {
+	if (context != nullptr) {
+		gl::finish();
+	}
+	// Joins the worker before the context it shares objects with goes.
+	programs.reset();
+
 	if (window != nullptr) {
 		SDL_DestroyWindow(window);
 	}
@@ -72,6 +82,7 @@ void GLAPIENTRY MessageCallback(GLenum source, GLenum type, GLuint id, GLenum se
 }
 
 auto render_loop::init() -> bool {
+	launch_time = SDL_GetPerformanceCounter();
 	if (SDL_Init(SDL_INIT_VIDEO) != 0) {
 		fmt::print(stderr, "Failed to initialize SDL.\n");
 		fmt::print(stderr, "Error {}: \n", SDL_GetError());
@@ -134,6 +145,8 @@ auto render_loop::init() -> bool {
 	glDebugMessageCallback(MessageCallback, nullptr);
 	#endif
 
+	programs = std::make_unique<gl::background_compiler>(window, context);
+
 	start_time = SDL_GetPerformanceCounter();
 	latest_tick_time = start_time;
 	latest_frame_time = start_time;
@@ -155,12 +168,13 @@ auto render_loop::loop(world& world, renderer& renderer) -> bool {
 	auto const current_time{SDL_GetPerformanceCounter()};
 	auto const time_since_last_frame{current_time - latest_frame_time};
 	if (current_time > latest_frame_time && time_since_last_frame >= min_frame_interval) {
-		EASY_BLOCK("RENDER LOOP");
+		TRACE_SCOPE_COARSE("RENDER LOOP");
 		latest_frame_time = current_time;
 		++fps_count;
 		if (current_time - latest_fps_count_time >= clock_frequency) {
 			latest_fps_count_time = current_time;
 			fmt::print("FPS: {}\n", fps_count);
+			TRACE_COUNTER("FPS", fps_count);
 			fps_count = 0;
 		}
 
@@ -233,13 +247,42 @@ auto render_loop::loop(world& world, renderer& renderer) -> bool {
 		EASY_BLOCK("SWAP WINDOW");
 		SDL_GL_SwapWindow(window);
 		EASY_END_BLOCK;
+		gl::end_frame();
+		gl::end_state_frame();
+		if (!first_frame_time) {
+			first_frame_time = SDL_GetPerformanceCounter();
+		}
+		if (!startup_reported && programs->idle()) {
+			startup_reported = true;
+			report_startup();
+		}
 	}
 	return true;
 }
 
+auto render_loop::report_startup() const -> void {
+	auto const programs{gl::program_stats()};
+	// Warm when every program, including the ones linked in the background, came from the binary cache.
+	fmt::print("First frame {:.0f} ms after launch ({} start), {} programs from the binary cache, {} compiled, {:.0f} ms linking\n",
+		static_cast<double>(*first_frame_time - launch_time) * clock_interval * 1000.0,
+		programs.compiled == 0 ? "warm" : "cold",
+		programs.loaded,
+		programs.compiled,
+		programs.milliseconds);
+}
+
 auto render_loop::show_render_setting_window(renderer& renderer) -> void {
 	ImGui::Begin("Render settings");
 	ImGui::Checkbox("Wireframe", &renderer.render_wireframe);
+	ImGui::SliderFloat("Min asteroid pixels", &renderer.min_asteroid_pixels, 0.f, 4.f, "%.2f");
+	auto asteroids{static_cast<int>(renderer.asteroid_rendering)};
+	if (ImGui::Combo("Asteroids", &asteroids, "Automatic\0Meshes\0Impostors\0Density\0")) {
+		renderer.asteroid_rendering = static_cast<asteroid_mode>(asteroids);
+	}
+	if (renderer.asteroid_rendering == asteroid_mode::density) {
+		ImGui::SliderFloat("Exposure", &renderer.density_exposure, 0.01f, 4.f, "%.2f", ImGuiSliderFlags_Logarithmic);
+		ImGui::Checkbox("Blur", &renderer.density_blur);
+	}
 	ImGui::End();
 }
 
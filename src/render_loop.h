@@ -5,7 +5,10 @@
 #include <cstdint>
 #include <functional>
 #include <cstddef>
+#include <memory>
+#include <optional>
 
+#include "background_compiler.h"
 #include "world.h"
 
 namespace gravity {
@@ -32,16 +35,23 @@ public:
 
 	auto start(world& world, renderer& renderer) -> int;
 
+	// Valid after a successful init, until the loop is destroyed.
+	[[nodiscard]] auto compiler() -> gl::background_compiler& {
+		return *programs;
+	}
+
 private:
 	auto loop(world& world, renderer& renderer) -> bool;
 	auto show_loop_settings_window() -> void;
 	// should be in a window class
 	auto toggle_window_fullscreen() -> void;
+	auto report_startup() const -> void;
 	
 	static auto show_render_setting_window(renderer& renderer) -> void;
 
 	SDL_Window* window{};
 	SDL_GLContext context{};
+	std::unique_ptr<gl::background_compiler> programs{};
 	uint64_t clock_frequency{};
 	float clock_interval{};
 	uint64_t tick_interval{};
@@ -52,6 +62,10 @@ private:
 	uint64_t latest_frame_time{};
 	uint64_t latest_fps_count_time{};
 	uint64_t start_time{};
+	uint64_t launch_time{};
+	// Reported once the background compiler is idle, it has linked every program by then.
+	std::optional<uint64_t> first_frame_time{};
+	bool startup_reported{false};
 	double max_fps{256};
 	size_t fps_count{0};
 	size_t tick_count{0};
@@ -1,86 +1,262 @@
 #include "renderer.h"
 
+#include "gl_state.h"
 #include "shape.h"
 
 #include "opengl.h"
 
 #include <algorithm>
+#include <array>
 #include <filesystem>
+#include <fmt/core.h>
+#include <functional>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <limits>
 
 #include <easy/profiler.h>
 
 
 namespace gravity {
 
-renderer::renderer()
+namespace {
+constexpr GLuint camera_uniforms_binding{0};
+// After the position and velocity buffers of the body table.
+constexpr GLuint model_instance_binding{2};
+constexpr GLuint visible_asteroids_binding{3};
+constexpr GLuint asteroid_commands_binding{4};
+constexpr GLuint modeled_bodies_binding{5};
+// Projected radius in pixels from which each finer asteroid level is used.
+constexpr auto lod_pixel_radius{std::array{12.f, 3.f}};
+// Projected radius in pixels below which automatic mode switches to impostors.
+constexpr float impostor_pixel_radius{1.5f};
+static_assert(impostor_pixel_radius < lod_pixel_radius.back(), "The coarsest mesh level would never be drawn");
+// The mesh levels, then the impostors.
+constexpr size_t impostor_level{renderer::asteroid_mesh_levels};
+constexpr size_t asteroid_levels{impostor_level + 1};
+
+// The std140 camera block every shader declares.
+struct camera_block {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 view_projection;
+};
+static_assert(sizeof(camera_block) == 3 * 64, "camera_block must match the std140 layout");
+
+// The layout glDrawElementsIndirect reads, its first four fields are also the layout of
+// glDrawArraysIndirect for the impostor command.
+struct draw_command {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+};
+} // namespace
+
+renderer::renderer(gl::background_compiler& compiler)
 	: default_shader{std::filesystem::path{"assets/shaders/default.vert"}, std::filesystem::path{"assets/shaders/default.frag"}}
 	, instanced_shader{std::filesystem::path{"assets/shaders/instanced.vert"}, std::filesystem::path{"assets/shaders/default.frag"}}
+	, model_shader{std::filesystem::path{"assets/shaders/models.vert"}, std::filesystem::path{"assets/shaders/default.frag"}}
+	, impostor_shader{compiler.submit({{GL_VERTEX_SHADER, std::filesystem::path{"assets/shaders/impostor.vert"}}, {GL_FRAGMENT_SHADER, std::filesystem::path{"assets/shaders/impostor.frag"}}})}
+	, density_shader{compiler.submit({{GL_VERTEX_SHADER, std::filesystem::path{"assets/shaders/density.vert"}}, {GL_FRAGMENT_SHADER, std::filesystem::path{"assets/shaders/density.frag"}}})}
 	, width{801}
 	, height{601}
 	, camera{90, static_cast<float>(width) / height, 0.01f, 1000.f}
-	, asteroid_model{shape::create_sphere(3, 0.1f)}
+	, asteroid_lods{shape::create_sphere(6), shape::create_sphere(3), shape::create_sphere(2)}
+	, density_splatting{compiler.submit({{GL_COMPUTE_SHADER, std::filesystem::path{"assets/shaders/splat.glsl"}}})}
+	, asteroid_culling{std::filesystem::path{"assets/shaders/cull.glsl"}}
 	{
 	// glEnable(GL_DEPTH_TEST);
 	// glEnable(GL_CULL_FACE);
 	// glCullFace(GL_BACK);
-	auto const instance_shader_position_location{instanced_shader.get_attrib_location("position")};
-	auto const instance_shader_normal_location{instanced_shader.get_attrib_location("normal")};
-	auto const instance_shader_uv_location{instanced_shader.get_attrib_location("uv")};
-	auto const instance_shader_model_location{instanced_shader.get_attrib_location("instance_model")};
-
-	instance_shader_mv_location = instanced_shader.get_uniform_location("m.vp");
-	default_shader_mvp_location = default_shader.get_uniform_location("m.mvp");
-
-	glGenBuffers(1, &asteroid_instance_buffer);
-	glBindBuffer(GL_ARRAY_BUFFER, asteroid_instance_buffer);
-	for (auto&& mesh : asteroid_model.meshes) {
-		glBindVertexArray(mesh.vao);
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), nullptr);
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
-		glEnableVertexAttribArray(5);
-		glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-		glEnableVertexAttribArray(6);
-		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-		glVertexAttribDivisor(3, 1);
-		glVertexAttribDivisor(4, 1);
-		glVertexAttribDivisor(5, 1);
-		glVertexAttribDivisor(6, 1);
-
-		glBindVertexArray(0);
-	}
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
+	instance_shader_scale_location = instanced_shader.get_uniform_location("scale");
+	instance_shader_first_visible_location = instanced_shader.get_uniform_location("first_visible");
+	instance_shader_reference_mass_location = instanced_shader.get_uniform_location("reference_mass");
+	default_shader_model_location = default_shader.get_uniform_location("model");
+	model_shader_first_instance_location = model_shader.get_uniform_location("first_instance");
+	model_instance_buffer = gl::buffer::create();
+	modeled_bodies_buffer = gl::buffer::create();
+	visible_asteroids = gl::buffer::create();
+	asteroid_commands = gl::buffer::create();
+	empty_vertices = gl::vertex_array::create();
+	camera_uniforms = gl::buffer::create();
+	gl::bind_buffer(GL_UNIFORM_BUFFER, camera_uniforms.get());
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(camera_block), nullptr, GL_DYNAMIC_DRAW);
+	gl::bind_buffer_base(GL_UNIFORM_BUFFER, camera_uniforms_binding, camera_uniforms.get());
+	gl::bind_buffer(GL_DRAW_INDIRECT_BUFFER, asteroid_commands.get());
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(asteroid_levels * sizeof(draw_command)), nullptr, GL_DYNAMIC_DRAW);
 }
 
-auto renderer::draw_model(model const& model, glm::vec3 const& position, float elapsed_time, float delta_time) const -> void {
-	auto model_matrix{glm::rotate(glm::translate(glm::mat4{rendering_tmp}, position), glm::radians(elapsed_time * 100.f), glm::vec3{0.f, 1.f, 0.f})};
+auto renderer::draw_model(model const& model, glm::vec3 const& position, float scale, float elapsed_time, float delta_time) const -> void {
+	auto model_matrix{glm::scale(glm::rotate(glm::translate(glm::mat4{rendering_tmp}, position), glm::radians(elapsed_time * 100.f), glm::vec3{0.f, 1.f, 0.f}), glm::vec3{scale})};
 
-	default_shader.upload_uniform_by_location(default_shader_mvp_location, camera.get_projection() * view * model_matrix);
+	default_shader.upload_uniform_by_location(default_shader_model_location, model_matrix);
 	for (auto&& mesh : model.meshes) {
 		draw_mesh(mesh, elapsed_time, delta_time);
 	}
 }
 
-auto renderer::draw_asteroid_instanced(size_t count) const -> void {
+auto renderer::draw_asteroid_instanced(size_t count) -> void {
 	(void)rendering_tmp;
+	if (count == 0) {
+		return;
+	}
+	// Until their programs are linked, density mode draws like automatic and impostors are not used.
+	if (asteroid_rendering == asteroid_mode::density && density_splatting.ready() && density_shader.ready()) {
+		draw_density(count);
+		return;
+	}
+	auto const impostors_ready{impostor_shader.ready()};
 	EASY_FUNCTION();
 
-	instanced_shader.use();
-	
+	// Every level gets room for all asteroids, compacted from the start of its range.
+	if (count > visible_capacity) {
+		visible_capacity = std::max(count, visible_capacity * 2);
+		gl::bind_buffer(GL_SHADER_STORAGE_BUFFER, visible_asteroids.get());
+		glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(visible_capacity * asteroid_levels * sizeof(GLuint)), nullptr, GL_DYNAMIC_COPY);
+	}
+	auto commands{std::array<draw_command, asteroid_levels>{}};
+	for (size_t lod{0}; lod < asteroid_lods.size(); ++lod) {
+		commands[lod] = draw_command{static_cast<GLuint>(asteroid_lods[lod]->meshes.front().size()), 0, 0, 0, 0};
+	}
+	commands[impostor_level] = draw_command{4, 0, 0, 0, 0};
+	auto const impostor_below{[&] {
+		if (!impostors_ready) {
+			return 0.f;
+		}
+		switch (asteroid_rendering) {
+			case asteroid_mode::meshes: return 0.f;
+			case asteroid_mode::impostors: return std::numeric_limits<float>::max();
+			case asteroid_mode::automatic:
+			case asteroid_mode::density: break;
+		}
+		return impostor_pixel_radius;
+	}()};
+	gl::bind_buffer(GL_DRAW_INDIRECT_BUFFER, asteroid_commands.get());
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(commands), commands.data());
+	gl::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, visible_asteroids_binding, visible_asteroids.get());
+	gl::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, asteroid_commands_binding, asteroid_commands.get());
+
+	EASY_BLOCK("CULL ASTEROIDS");
+	asteroid_culling.use();
+	asteroid_culling.upload_uniform("pixel_scale", camera.get_projection()[1][1] * static_cast<float>(height) * 0.5f);
+	asteroid_culling.upload_uniform("radius", asteroid_radius);
+	asteroid_culling.upload_uniform("reference_mass", asteroid_reference_mass);
+	asteroid_culling.upload_uniform("impostor_pixel_radius", impostor_below);
+	asteroid_culling.upload_uniform("body_count", static_cast<int>(count));
+	// Bodies with a model of their own are skipped, their mass would blow their asteroid up around the model.
+	modeled_bodies.resize((count + 31) / 32);
+	gl::bind_buffer(GL_SHADER_STORAGE_BUFFER, modeled_bodies_buffer.get());
+	glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(modeled_bodies.size() * sizeof(uint32_t)), modeled_bodies.data(), GL_STREAM_DRAW);
+	gl::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, modeled_bodies_binding, modeled_bodies_buffer.get());
+	asteroid_culling.upload_uniform("visible_stride", static_cast<int>(visible_capacity));
+	asteroid_culling.upload_uniform("min_pixel_radius", min_asteroid_pixels);
+	for (size_t i{0}; i < lod_pixel_radius.size(); ++i) {
+		asteroid_culling.upload_uniform(fmt::format("lod_pixel_radius[{}]", i), lod_pixel_radius[i]);
+	}
+	asteroid_culling.dispatch(static_cast<unsigned int>((count + 63) / 64), 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+	EASY_END_BLOCK;
+
 	EASY_BLOCK("DRAW INSTANCED", profiler::FORCE_ON);
-	instanced_shader.upload_uniform_by_location(instance_shader_mv_location, camera.get_projection() * view);
-	for (auto&& mesh : asteroid_model.meshes) {
-		EASY_BLOCK("MESH");
-		glBindVertexArray(mesh.vao);
-		glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(mesh.size()), GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(count));
-		glBindVertexArray(0);
-		EASY_END_BLOCK;
+	instanced_shader.use();
+	instanced_shader.upload_uniform_by_location(instance_shader_scale_location, asteroid_radius);
+	instanced_shader.upload_uniform_by_location(instance_shader_reference_mass_location, asteroid_reference_mass);
+	gl::bind_buffer(GL_DRAW_INDIRECT_BUFFER, asteroid_commands.get());
+	for (size_t lod{0}; lod < asteroid_lods.size(); ++lod) {
+		instanced_shader.upload_uniform_by_location(instance_shader_first_visible_location, static_cast<int>(lod * visible_capacity));
+		gl::bind_vertex_array(asteroid_lods[lod]->meshes.front().vao.get());
+		glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<void const*>(lod * sizeof(draw_command)));
+	}
+
+	if (impostors_ready) {
+		impostor_shader->use();
+		impostor_shader->upload_uniform("radius", asteroid_radius);
+		impostor_shader->upload_uniform("reference_mass", asteroid_reference_mass);
+		impostor_shader->upload_uniform("first_visible", static_cast<int>(impostor_level * visible_capacity));
+		gl::bind_vertex_array(empty_vertices.get());
+		glDrawArraysIndirect(GL_TRIANGLE_STRIP, reinterpret_cast<void const*>(impostor_level * sizeof(draw_command)));
+	}
+	EASY_END_BLOCK;
+	default_shader.use();
+}
+
+auto renderer::draw_density(size_t count) -> void {
+	EASY_FUNCTION();
+	if (!density || density_width != width || density_height != height) {
+		density = gl::texture::create();
+		density_width = width;
+		density_height = height;
+		glBindTexture(GL_TEXTURE_2D, density.get());
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, width, height);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	constexpr GLuint zero{0};
+	glClearTexImage(density.get(), 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+	EASY_BLOCK("SPLAT");
+	glBindImageTexture(0, density.get(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+	density_splatting->use();
+	density_splatting->upload_uniform("body_count", static_cast<int>(count));
+	density_splatting->dispatch(static_cast<unsigned int>((count + 63) / 64), 1, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	EASY_END_BLOCK;
+
+	density_shader->use();
+	density_shader->upload_uniform("density", 0);
+	density_shader->upload_uniform("exposure", density_exposure);
+	density_shader->upload_uniform("blur", density_blur ? 1 : 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, density.get());
+	gl::bind_vertex_array(empty_vertices.get());
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	default_shader.use();
+}
+
+auto renderer::queue_model(model const& model, model_instance const& instance) -> void {
+	queued_models.emplace_back(&model, instance);
+	if (instance.slot >= 0) {
+		auto const word{static_cast<size_t>(instance.slot) / 32};
+		if (word >= modeled_bodies.size()) {
+			modeled_bodies.resize(word + 1);
+		}
+		modeled_bodies[word] |= uint32_t{1} << (instance.slot % 32);
+	}
+}
+
+auto renderer::draw_queued_models() -> void {
+	modeled_bodies.clear();
+	if (queued_models.empty()) {
+		return;
+	}
+	EASY_FUNCTION();
+	std::stable_sort(queued_models.begin(), queued_models.end(), [](auto const& a, auto const& b) { return std::less{}(a.first, b.first); });
+	model_instances.clear();
+	for (auto const& [model, instance] : queued_models) {
+		model_instances.push_back(instance);
+	}
+	// Orphans the storage the previous frame may still read.
+	gl::bind_buffer(GL_SHADER_STORAGE_BUFFER, model_instance_buffer.get());
+	glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(model_instances.size() * sizeof(model_instance)), model_instances.data(), GL_STREAM_DRAW);
+	gl::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, model_instance_binding, model_instance_buffer.get());
+
+	model_shader.use();
+	for (size_t first{0}; first < queued_models.size();) {
+		auto const* model{queued_models[first].first};
+		auto last{first + 1};
+		while (last < queued_models.size() && queued_models[last].first == model) {
+			++last;
+		}
+		model_shader.upload_uniform_by_location(model_shader_first_instance_location, static_cast<int>(first));
+		for (auto&& mesh : model->meshes) {
+			gl::bind_vertex_array(mesh.vao.get());
+			glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(mesh.size()), GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(last - first));
+		}
+		first = last;
 	}
+	queued_models.clear();
 	default_shader.use();
 }
 
@@ -88,10 +264,9 @@ auto renderer::draw_mesh(mesh const& mesh, float elapsed_time, float delta_time)
 	(void)rendering_tmp;
 	(void)elapsed_time;
 	(void)delta_time;
-	assert(mesh.vao != 0 && "Mesh buffers must be generated before drawing");
-	glBindVertexArray(mesh.vao);
+	assert(mesh.vao && "Mesh buffers must be generated before drawing");
+	gl::bind_vertex_array(mesh.vao.get());
 	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.size()), GL_UNSIGNED_INT, nullptr);
-	glBindVertexArray(0);
 }
 
 auto renderer::start_renderer(glm::mat4& render_view) -> void {
@@ -107,6 +282,9 @@ auto renderer::start_renderer(glm::mat4& render_view) -> void {
 	}
 	default_shader.use();
 	view = glm::mat4{render_view};
+	auto const block{camera_block{view, camera.get_projection(), camera.get_projection() * view}};
+	gl::bind_buffer(GL_UNIFORM_BUFFER, camera_uniforms.get());
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
 }
 
 } // namespace gravity
@@ -1,23 +1,55 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include "background_compiler.h"
 #include "camera.h"
+#include "compute.h"
 #include "mesh.h"
 #include "model.h"
 #include "shader.h"
 
+#include <array>
+#include <cstdint>
 #include <span>
+#include <utility>
 #include <vector>
 
 namespace gravity {
 
+// One entity drawn by draw_queued_models, in the std430 layout of models.vert.
+struct model_instance {
+	glm::vec3 position{};
+	float scale{1.f};
+	// The body slot whose position the instance follows, -1 to stay at position.
+	int32_t slot{-1};
+	std::array<int32_t, 3> padding{};
+};
+static_assert(sizeof(model_instance) == 32, "model_instance must match the std430 layout");
+
+enum class asteroid_mode : int {
+	// Meshes up close, impostors once they cover a few pixels.
+	automatic,
+	meshes,
+	impostors,
+	// Bodies per pixel, accumulated by a compute pass and tone mapped, no geometry per body.
+	density,
+};
+
 class renderer {
 public:
-	renderer();
+	// Links the programs only some asteroid modes use on compiler, the first frame does not wait for them.
+	explicit renderer(gl::background_compiler& compiler);
 
-	auto draw_model(model const& model, glm::vec3 const& position, float elapsed_time, float delta_time) const -> void;
-	auto draw_asteroid_instanced(size_t count) const -> void;
+	auto draw_model(model const& model, glm::vec3 const& position, float scale, float elapsed_time, float delta_time) const -> void;
+	// Culls the first count bodies against the view and draws each at the level of detail its
+	// projected size calls for, without reading anything back.
+	auto draw_asteroid_instanced(size_t count) -> void;
 	auto draw_mesh(mesh const& mesh, float elapsed_time, float delta_time) const -> void;
+	// The model must outlive the next draw_queued_models. Queued before draw_asteroid_instanced,
+	// the asteroid of a body with a slot is not drawn.
+	auto queue_model(model const& model, model_instance const& instance) -> void;
+	// Draws the queued instances with one instanced draw per mesh of each model.
+	auto draw_queued_models() -> void;
 	auto start_renderer(glm::mat4& render_view) -> void;
 	
 	auto start_non_instanced() -> void {
@@ -29,22 +61,62 @@ public:
 		camera.set_aspect_ratio(width, height);
 	}
 
+	// Sphere resolutions asteroids are drawn at, cull.glsl has the same count.
+	static constexpr size_t asteroid_mesh_levels{3};
+
 	bool render_wireframe{false}; // NOLINT
+	// Asteroids projected smaller than this many pixels are culled.
+	float min_asteroid_pixels{0.25f}; // NOLINT
+	asteroid_mode asteroid_rendering{asteroid_mode::automatic}; // NOLINT
+	float density_exposure{0.5f}; // NOLINT
+	bool density_blur{true}; // NOLINT
 
 private:
+	auto draw_density(size_t count) -> void;
+
 	shader_program default_shader;
 	shader_program instanced_shader;
+	shader_program model_shader;
+	gl::deferred_program<shader_program> impostor_shader;
+	gl::deferred_program<shader_program> density_shader;
+	// Before camera, which is initialized with their aspect ratio.
+	int width{800};
+	int height{600};
 	camera camera;
 	glm::mat4 view{};
 
-	int width{800};
-	int height{600};
     float rendering_tmp{1.f};
 
-	unsigned int asteroid_instance_buffer{0};
-	int instance_shader_mv_location{0};
-	int default_shader_mvp_location{0};
-	model asteroid_model;
+	int instance_shader_scale_location{0};
+	int instance_shader_first_visible_location{0};
+	int instance_shader_reference_mass_location{0};
+	int default_shader_model_location{0};
+	int model_shader_first_instance_location{0};
+	float asteroid_radius{0.1f};
+	// The mass of an asteroid_radius body, radii grow with the cube root of mass.
+	float asteroid_reference_mass{0.01f};
+	// Finest first, cull.glsl picks one per asteroid by projected size or an impostor after them.
+	std::array<shared_model, asteroid_mesh_levels> asteroid_lods;
+	// View and projection for every program, written by start_renderer.
+	gl::buffer camera_uniforms{};
+	// Impostor quads and the density pass have no vertex data, but drawing needs a vertex array bound.
+	gl::vertex_array empty_vertices{};
+
+	gl::deferred_program<compute> density_splatting;
+	gl::texture density{};
+	int density_width{0};
+	int density_height{0};
+	compute asteroid_culling;
+	gl::buffer visible_asteroids{};
+	gl::buffer asteroid_commands{};
+	size_t visible_capacity{0};
+
+	gl::buffer model_instance_buffer{};
+	std::vector<std::pair<model const*, model_instance>> queued_models{};
+	std::vector<model_instance> model_instances{};
+	// One bit per body slot, set for the slots a queued model follows.
+	gl::buffer modeled_bodies_buffer{};
+	std::vector<uint32_t> modeled_bodies{};
 
 };
 
@@ -0,0 +1,111 @@
+#include "background_compiler.h"
+
+#include <exception>
+#include <fmt/core.h>
+#include <stdexcept>
+#include <string>
+#include <trace.h>
+
+namespace gravity::gl {
+
+namespace {
+auto link(std::vector<shader_stage> const& stages) -> GLuint {
+	auto const program{glCreateProgram()};
+	try {
+		if (!link_program(program, stages)) {
+			throw std::runtime_error{fmt::format("Failed to link {}", stages.empty() ? std::string{} : stages.front().path.string())};
+		}
+	} catch (std::runtime_error const&) {
+		glDeleteProgram(program);
+		throw;
+	}
+	return program;
+}
+} // namespace
+
+background_compiler::background_compiler(SDL_Window* window, SDL_GLContext render_context)
+	: window{window} {
+	SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+	context = SDL_GL_CreateContext(window);
+	SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+	SDL_GL_MakeCurrent(window, render_context);
+	if (context == nullptr) {
+		fmt::print(stderr, "Failed to create a shared GL context, programs link on the render thread: {}\n", SDL_GetError());
+		return;
+	}
+	worker = std::thread{[this] { run(); }};
+}
+
+background_compiler::~background_compiler() {
+	if (context == nullptr) {
+		return;
+	}
+	{
+		auto const lock{std::scoped_lock{queue_mutex}};
+		stopping = true;
+	}
+	queue_condition.notify_one();
+	worker.join();
+	SDL_GL_DeleteContext(context);
+}
+
+auto background_compiler::submit(std::vector<shader_stage> stages) -> std::future<GLuint> {
+	auto linked{std::promise<GLuint>{}};
+	auto future{linked.get_future()};
+	if (context == nullptr) {
+		try {
+			linked.set_value(link(stages));
+		} catch (std::runtime_error const&) {
+			linked.set_exception(std::current_exception());
+		}
+		return future;
+	}
+	{
+		auto const lock{std::scoped_lock{queue_mutex}};
+		queue.push_back(job{std::move(stages), std::move(linked)});
+		++pending;
+	}
+	queue_condition.notify_one();
+	return future;
+}
+
+auto background_compiler::idle() -> bool {
+	auto const lock{std::scoped_lock{queue_mutex}};
+	return pending == 0;
+}
+
+auto background_compiler::run() -> void {
+	trace::set_thread_name("shader compiler");
+	SDL_GL_MakeCurrent(window, context);
+	auto const start{SDL_GetPerformanceCounter()};
+	size_t linked{0};
+	auto lock{std::unique_lock{queue_mutex}};
+	while (true) {
+		queue_condition.wait(lock, [this] { return stopping || !queue.empty(); });
+		if (queue.empty()) {
+			break;
+		}
+		auto next{std::move(queue.front())};
+		queue.pop_front();
+		lock.unlock();
+		try {
+			auto const program{link(next.stages)};
+			// Objects are only complete in other contexts once the commands creating them have finished.
+			glFinish();
+			next.linked.set_value(program);
+		} catch (std::runtime_error const&) {
+			// Rethrown by the future, on the render thread.
+			next.linked.set_exception(std::current_exception());
+		}
+		++linked;
+		lock.lock();
+		--pending;
+		if (queue.empty()) {
+			auto const seconds{static_cast<double>(SDL_GetPerformanceCounter() - start) / static_cast<double>(SDL_GetPerformanceFrequency())};
+			fmt::print("Linked {} programs in the background after {:.0f} ms\n", linked, seconds * 1000.0);
+		}
+	}
+	SDL_GL_MakeCurrent(window, nullptr);
+}
+
+} // namespace gravity::gl
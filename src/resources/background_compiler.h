@@ -0,0 +1,98 @@
+#ifndef BACKGROUND_COMPILER_H
+#define BACKGROUND_COMPILER_H
+
+#include "program_cache.h"
+
+#include <SDL.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace gravity::gl {
+
+// Links programs on a worker thread whose context shares objects with the render context, for
+// the programs the first frame does not need. Links on the calling thread instead when the
+// shared context can not be created.
+class background_compiler {
+public:
+	// Call with render_context current on window, it is current again on return.
+	background_compiler(SDL_Window* window, SDL_GLContext render_context);
+	~background_compiler();
+	background_compiler(background_compiler const&) = delete;
+	auto operator=(background_compiler const&) -> background_compiler& = delete;
+	background_compiler(background_compiler&&) = delete;
+	auto operator=(background_compiler&&) -> background_compiler& = delete;
+
+	// The program is complete and usable from the render context once the future is ready, the
+	// future throws std::runtime_error when it failed to link.
+	[[nodiscard]] auto submit(std::vector<shader_stage> stages) -> std::future<GLuint>;
+	// Every submitted program has finished linking.
+	[[nodiscard]] auto idle() -> bool;
+
+private:
+	struct job {
+		std::vector<shader_stage> stages;
+		std::promise<GLuint> linked;
+	};
+
+	auto run() -> void;
+
+	SDL_Window* window;
+	SDL_GLContext context{nullptr};
+	std::mutex queue_mutex{};
+	std::condition_variable queue_condition{};
+	std::deque<job> queue{};
+	// Queued or linking.
+	size_t pending{0};
+	bool stopping{false};
+	std::thread worker{};
+};
+
+// A program linking on a background_compiler, Program is constructed from the linked name.
+template <typename Program>
+class deferred_program {
+public:
+	explicit deferred_program(std::future<GLuint> linking)
+		: linking{std::move(linking)} {}
+	~deferred_program() {
+		// The worker may still be linking it, waiting keeps the name from leaking.
+		if (linking.valid()) {
+			try {
+				glDeleteProgram(linking.get());
+			} catch (std::runtime_error const&) {
+				// Deleted by the compiler when it failed to link.
+			}
+		}
+	}
+	deferred_program(deferred_program const&) = delete;
+	auto operator=(deferred_program const&) -> deferred_program& = delete;
+	deferred_program(deferred_program&&) = delete;
+	auto operator=(deferred_program&&) -> deferred_program& = delete;
+
+	// Never waits for the worker, throws std::runtime_error when the program failed to link.
+	[[nodiscard]] auto ready() -> bool {
+		if (!program && linking.wait_for(std::chrono::seconds{0}) == std::future_status::ready) {
+			program.emplace(linking.get());
+		}
+		return program.has_value();
+	}
+	auto operator->() -> Program* {
+		return &*program;
+	}
+
+private:
+	std::future<GLuint> linking;
+	std::optional<Program> program{};
+};
+
+} // namespace gravity::gl
+
+#endif
@@ -0,0 +1,125 @@
+#include "gl_resources.h"
+
+#include "gl_state.h"
+
+#include <deque>
+#include <vector>
+
+namespace gravity::gl {
+
+namespace {
+
+struct batch {
+	GLsync fence{nullptr};
+	std::vector<GLuint> buffers{};
+	std::vector<GLuint> vertex_arrays{};
+	std::vector<GLuint> textures{};
+
+	[[nodiscard]] auto size() const -> size_t {
+		return buffers.size() + vertex_arrays.size() + textures.size();
+	}
+};
+
+struct release_queue {
+	resource_stats live{};
+	batch recording{};
+	std::deque<batch> in_flight{};
+};
+
+// Function local, so handles are usable from static initializers.
+auto queue() -> release_queue& {
+	static auto released{release_queue{}};
+	return released;
+}
+
+auto destroy(batch& released) -> void {
+	if (!released.buffers.empty()) {
+		glDeleteBuffers(static_cast<GLsizei>(released.buffers.size()), released.buffers.data());
+	}
+	if (!released.vertex_arrays.empty()) {
+		glDeleteVertexArrays(static_cast<GLsizei>(released.vertex_arrays.size()), released.vertex_arrays.data());
+	}
+	if (!released.textures.empty()) {
+		glDeleteTextures(static_cast<GLsizei>(released.textures.size()), released.textures.data());
+	}
+	if (released.fence != nullptr) {
+		glDeleteSync(released.fence);
+	}
+	if (released.size() > 0) {
+		invalidate_state();
+	}
+	auto& live{queue().live};
+	live.buffers -= released.buffers.size();
+	live.vertex_arrays -= released.vertex_arrays.size();
+	live.textures -= released.textures.size();
+	live.pending -= released.size();
+	released = batch{};
+}
+
+auto signaled(GLsync fence) -> bool {
+	auto const status{glClientWaitSync(fence, 0, 0)};
+	return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+} // namespace
+
+auto generate(object kind) -> GLuint {
+	GLuint name{0};
+	switch (kind) {
+		case object::buffer: glGenBuffers(1, &name); break;
+		case object::vertex_array: glGenVertexArrays(1, &name); break;
+		case object::texture: glGenTextures(1, &name); break;
+	}
+	track(kind);
+	return name;
+}
+
+auto track(object kind) -> void {
+	auto& live{queue().live};
+	switch (kind) {
+		case object::buffer: ++live.buffers; break;
+		case object::vertex_array: ++live.vertex_arrays; break;
+		case object::texture: ++live.textures; break;
+	}
+}
+
+auto release(object kind, GLuint name) -> void {
+	auto& released{queue()};
+	switch (kind) {
+		case object::buffer: released.recording.buffers.push_back(name); break;
+		case object::vertex_array: released.recording.vertex_arrays.push_back(name); break;
+		case object::texture: released.recording.textures.push_back(name); break;
+	}
+	++released.live.pending;
+}
+
+auto stats() -> resource_stats {
+	return queue().live;
+}
+
+auto end_frame() -> void {
+	auto& recording{queue().recording};
+	auto& in_flight{queue().in_flight};
+	if (recording.size() > 0) {
+		recording.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		in_flight.push_back(std::move(recording));
+		recording = batch{};
+	}
+	while (!in_flight.empty() && signaled(in_flight.front().fence)) {
+		destroy(in_flight.front());
+		in_flight.pop_front();
+	}
+}
+
+auto finish() -> void {
+	auto& recording{queue().recording};
+	auto& in_flight{queue().in_flight};
+	glFinish();
+	for (auto& released : in_flight) {
+		destroy(released);
+	}
+	in_flight.clear();
+	destroy(recording);
+}
+
+} // namespace gravity::gl
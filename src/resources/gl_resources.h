@@ -0,0 +1,94 @@
+#ifndef GL_RESOURCES_H
+#define GL_RESOURCES_H
+
+#include "opengl.h"
+
+#include <cstddef>
+#include <utility>
+
+namespace gravity::gl {
+
+enum class object {
+	buffer,
+	vertex_array,
+	texture,
+};
+
+auto generate(object kind) -> GLuint;
+// Counts a name generated elsewhere as live.
+auto track(object kind) -> void;
+// Queues name for deletion once the GPU has finished the frame being recorded.
+auto release(object kind, GLuint name) -> void;
+
+// Owns one GL name, move only. Destroying it defers the deletion until end_frame has seen
+// the GPU finish every command that may still use the object.
+template <object Kind>
+class handle {
+public:
+	handle() = default;
+	~handle() {
+		reset();
+	}
+	handle(handle const&) = delete;
+	auto operator=(handle const&) -> handle& = delete;
+	handle(handle&& other) noexcept
+		: name{std::exchange(other.name, 0)} {}
+	auto operator=(handle&& other) noexcept -> handle& {
+		if (this != &other) {
+			reset();
+			name = std::exchange(other.name, 0);
+		}
+		return *this;
+	}
+
+	[[nodiscard]] static auto create() -> handle {
+		return handle{generate(Kind)};
+	}
+	// Takes ownership of a name generated without create.
+	[[nodiscard]] static auto adopt(GLuint name) -> handle {
+		track(Kind);
+		return handle{name};
+	}
+
+	[[nodiscard]] auto get() const -> GLuint {
+		return name;
+	}
+	explicit operator bool() const {
+		return name != 0;
+	}
+	auto reset() -> void {
+		if (name != 0) {
+			release(Kind, std::exchange(name, 0));
+		}
+	}
+
+private:
+	explicit handle(GLuint name)
+		: name{name} {}
+
+	GLuint name{0};
+};
+
+using buffer = handle<object::buffer>;
+using vertex_array = handle<object::vertex_array>;
+using texture = handle<object::texture>;
+
+struct resource_stats {
+	size_t buffers{0};
+	size_t vertex_arrays{0};
+	size_t textures{0};
+	// Released but still waiting for the GPU.
+	size_t pending{0};
+};
+
+[[nodiscard]] auto stats() -> resource_stats;
+
+// Fences the names released since the last call and deletes those the GPU is done with,
+// call once per frame after the swap.
+auto end_frame() -> void;
+// Waits for the GPU and deletes every released name, call before the context is destroyed.
+auto finish() -> void;
+
+} // namespace gravity::gl
+
+#endif
@@ -0,0 +1,97 @@
+#include "gl_state.h"
+
+#include <array>
+#include <optional>
+
+namespace gravity::gl {
+
+namespace {
+
+constexpr auto cached_targets{std::array<GLenum, 6>{
+	GL_ARRAY_BUFFER,
+	GL_COPY_READ_BUFFER,
+	GL_COPY_WRITE_BUFFER,
+	GL_DRAW_INDIRECT_BUFFER,
+	GL_SHADER_STORAGE_BUFFER,
+	GL_UNIFORM_BUFFER,
+}};
+
+struct bindings {
+	// Empty until the first bind, the state before that is not known.
+	std::optional<GLuint> program{};
+	std::optional<GLuint> vertex_array{};
+	std::array<std::optional<GLuint>, cached_targets.size()> buffers{};
+};
+
+auto current{bindings{}};
+auto counting{state_stats{}};
+auto last_frame{state_stats{}};
+
+auto target_index(GLenum target) -> std::optional<size_t> {
+	for (size_t i{0}; i < cached_targets.size(); ++i) {
+		if (cached_targets[i] == target) {
+			return i;
+		}
+	}
+	return std::nullopt;
+}
+
+// Returns true if the call has to be issued and remembers its binding.
+auto changes(std::optional<GLuint>& bound, GLuint name) -> bool {
+	if (bound == name) {
+		++counting.skipped;
+		return false;
+	}
+	bound = name;
+	++counting.issued;
+	return true;
+}
+
+} // namespace
+
+auto use_program(GLuint program) -> void {
+	if (changes(current.program, program)) {
+		glUseProgram(program);
+	}
+}
+
+auto bind_vertex_array(GLuint vertex_array) -> void {
+	if (changes(current.vertex_array, vertex_array)) {
+		glBindVertexArray(vertex_array);
+	}
+}
+
+auto bind_buffer(GLenum target, GLuint buffer) -> void {
+	auto const index{target_index(target)};
+	if (!index) {
+		++counting.issued;
+		glBindBuffer(target, buffer);
+		return;
+	}
+	if (changes(current.buffers[*index], buffer)) {
+		glBindBuffer(target, buffer);
+	}
+}
+
+auto bind_buffer_base(GLenum target, GLuint index, GLuint buffer) -> void {
+	++counting.issued;
+	glBindBufferBase(target, index, buffer);
+	if (auto const cached{target_index(target)}) {
+		current.buffers[*cached] = buffer;
+	}
+}
+
+auto invalidate_state() -> void {
+	current = bindings{};
+}
+
+auto frame_state_stats() -> state_stats {
+	return last_frame;
+}
+
+auto end_state_frame() -> void {
+	last_frame = counting;
+	counting = state_stats{};
+}
+
+} // namespace gravity::gl
@@ -0,0 +1,32 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include "opengl.h"
+
+#include <cstddef>
+
+namespace gravity::gl {
+
+// Binds through a cache of the current bindings and skips the calls that would not change
+// them. Every bind of the cached state has to go through here for the cache to stay valid.
+auto use_program(GLuint program) -> void;
+auto bind_vertex_array(GLuint vertex_array) -> void;
+// GL_ELEMENT_ARRAY_BUFFER is part of the bound vertex array and is never skipped.
+auto bind_buffer(GLenum target, GLuint buffer) -> void;
+// Also binds the generic target, like glBindBufferBase does.
+auto bind_buffer_base(GLenum target, GLuint index, GLuint buffer) -> void;
+// Forgets every cached binding, deleted names may be generated again.
+auto invalidate_state() -> void;
+
+struct state_stats {
+	size_t issued{0};
+	size_t skipped{0};
+};
+
+// The calls of the last finished frame.
+[[nodiscard]] auto frame_state_stats() -> state_stats;
+auto end_state_frame() -> void;
+
+} // namespace gravity::gl
+
+#endif
@@ -1,5 +1,7 @@
 #include "mesh.h"
 
+#include "gl_state.h"
+
 #include <utility>
 
 #include <algorithm>
@@ -9,20 +11,21 @@ namespace gravity {
 
 mesh::mesh(std::vector<unsigned int> const&& indices, std::vector<vertex> const&& vertices)
 	: indices{std::move(indices)}
-    , vertices{std::move(vertices)} {}
+    , vertices{std::move(vertices)}
+	, index_count{this->indices.size()} {}
 
 auto mesh::generate_buffer() -> void {
-    glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo);
-	glGenBuffers(1, &ebo);
+    vao = gl::vertex_array::create();
+	vbo = gl::buffer::create();
+	ebo = gl::buffer::create();
 
-	glBindVertexArray(vao);
+	gl::bind_vertex_array(vao.get());
 
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertex), &vertices[0], GL_DYNAMIC_DRAW);
+	gl::bind_buffer(GL_ARRAY_BUFFER, vbo.get());
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertex), &vertices[0], GL_STATIC_DRAW);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_DYNAMIC_DRAW);
+	gl::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ebo.get());
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
 	/// test
 	// Vertex positions
@@ -35,23 +38,11 @@ auto mesh::generate_buffer() -> void {
 	glEnableVertexAttribArray(2);
 	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, uv));
 
-	glBindVertexArray(0);
-	
-}
-
-auto mesh::update_buffer(std::vector<unsigned int> const&& new_indices, std::vector<vertex> const&& new_vertices) -> void {
-	assert(vao != 0 && "Must generate buffers before updating them");
-	vertices.assign(std::begin(new_vertices), std::end(new_vertices));
-	indices.assign(std::begin(new_indices), std::end(new_indices));
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertex), &vertices[0], GL_DYNAMIC_DRAW);
+	gl::bind_vertex_array(0);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_DYNAMIC_DRAW);
+	index_count = indices.size();
+	indices = {};
+	vertices = {};
 }
 
-
-
-
 } // namespace gravity::resources
\ No newline at end of file
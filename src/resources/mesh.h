@@ -1,6 +1,8 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include "gl_resources.h"
+
 #include <vector>
 #include <glm/glm.hpp>
 
@@ -15,21 +17,21 @@ struct vertex {
 class mesh {
 public:
     mesh(std::vector<unsigned int> const&& indices, std::vector<vertex> const&& vertices);
+    // Uploads the geometry and frees the CPU copy.
     auto generate_buffer() -> void;
 
-    auto update_buffer(std::vector<unsigned int> const&& indices, std::vector<vertex> const&& vertices) -> void;
-
     [[nodiscard]] auto size() const -> size_t {
-        return indices.size();
+        return index_count;
     }
 
-    unsigned int vao{};
-    unsigned int vbo{};
-    unsigned int ebo{};
+    gl::vertex_array vao{};
+    gl::buffer vbo{};
+    gl::buffer ebo{};
 
 	std::vector<unsigned int> indices{};
 	std::vector<vertex> vertices{};
 private:
+	size_t index_count{0};
 };
 
 } // namespace gravity::resources
@@ -0,0 +1,226 @@
+#include "program_cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fmt/format.h>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace gravity::gl {
+
+namespace {
+
+constexpr uint32_t cache_magic{0x47505243}; // "GPRC"
+constexpr uint32_t cache_version{1};
+
+struct cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t source_hash;
+	uint32_t driver_length;
+	uint32_t format;
+	uint64_t binary_length;
+};
+
+std::atomic<bool> skip_cache{false};
+std::atomic<size_t> programs_loaded{0};
+std::atomic<size_t> programs_compiled{0};
+std::atomic<uint64_t> link_microseconds{0};
+
+auto cache_directory() -> std::filesystem::path {
+	return std::filesystem::path{"cache"} / "shaders";
+}
+
+// FNV-1a.
+auto hash(uint64_t seed, void const* data, size_t size) -> uint64_t {
+	auto const* bytes{static_cast<unsigned char const*>(data)};
+	for (size_t i{0}; i < size; ++i) {
+		seed = (seed ^ bytes[i]) * 0x100000001b3;
+	}
+	return seed;
+}
+
+// Any of these changing may make stored binaries invalid, glProgramBinary rejecting them is the last check.
+auto driver() -> std::string {
+	auto const text{[](GLenum name) {
+		auto const* value{reinterpret_cast<char const*>(glGetString(name))};
+		return value != nullptr ? std::string{value} : std::string{};
+	}};
+	return fmt::format("{}|{}|{}", text(GL_VENDOR), text(GL_RENDERER), text(GL_VERSION));
+}
+
+auto read_source(std::filesystem::path const& path) -> std::string {
+	std::ifstream file{path};
+	if (!file || !file.is_open()) {
+		throw std::runtime_error{fmt::format("Failed to read shader {}", path.string())};
+	}
+	return std::string{(std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()};
+}
+
+auto cache_path(uint64_t source_hash) -> std::filesystem::path {
+	return cache_directory() / fmt::format("{:016x}.bin", source_hash);
+}
+
+auto print_shader_info(GLuint shader, std::filesystem::path const& path) -> void {
+	GLint info_log_length{0};
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
+	if (info_log_length > 2) {
+		fmt::print(stderr, "[From {}:]\n", path.string());
+		std::string info_log{};
+		info_log.resize(info_log_length);
+		glGetShaderInfoLog(shader, info_log_length, nullptr, info_log.data());
+		fmt::print(stderr, "{}\n", info_log);
+	}
+}
+
+auto print_program_info(GLuint program) -> void {
+	GLint log_length{0};
+	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_length);
+	if (log_length > 2) {
+		fmt::print(stderr, "Shader program {}:\n", program);
+		std::string info_log{};
+		info_log.resize(log_length);
+		glGetProgramInfoLog(program, log_length, nullptr, info_log.data());
+		fmt::print(stderr, "{}\n", info_log);
+	}
+}
+
+auto linked(GLuint program) -> bool {
+	GLint status{GL_FALSE};
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	return status == GL_TRUE;
+}
+
+auto load_binary(GLuint program, uint64_t source_hash, std::string const& driver_name) -> bool {
+	std::ifstream file{cache_path(source_hash), std::ios::binary};
+	if (!file) {
+		return false;
+	}
+	auto header{cache_header{}};
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != cache_magic || header.version != cache_version
+		|| header.source_hash != source_hash || header.driver_length != driver_name.size()) {
+		return false;
+	}
+	auto stored_driver{std::string(header.driver_length, '\0')};
+	auto binary{std::vector<char>(header.binary_length)};
+	if (!file.read(stored_driver.data(), static_cast<std::streamsize>(stored_driver.size())) || stored_driver != driver_name
+		|| !file.read(binary.data(), static_cast<std::streamsize>(binary.size()))) {
+		return false;
+	}
+	glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+	return linked(program);
+}
+
+auto store_binary(GLuint program, uint64_t source_hash, std::string const& driver_name) -> void {
+	GLint length{0};
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+	auto binary{std::vector<char>(static_cast<size_t>(length))};
+	GLenum format{0};
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	auto error{std::error_code{}};
+	std::filesystem::create_directories(cache_directory(), error);
+	// Written aside and renamed, a concurrent launch never reads half a binary.
+	auto const path{cache_path(source_hash)};
+	auto staged{path};
+	staged += ".tmp";
+	{
+		std::ofstream file{staged, std::ios::binary | std::ios::trunc};
+		auto const header{cache_header{
+			.magic = cache_magic,
+			.version = cache_version,
+			.source_hash = source_hash,
+			.driver_length = static_cast<uint32_t>(driver_name.size()),
+			.format = format,
+			.binary_length = static_cast<uint64_t>(length),
+		}};
+		file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+		file.write(driver_name.data(), static_cast<std::streamsize>(driver_name.size()));
+		file.write(binary.data(), length);
+		if (!file) {
+			fmt::print(stderr, "Failed to store program binary {}\n", staged.string());
+			return;
+		}
+	}
+	std::filesystem::rename(staged, path, error);
+	if (error) {
+		fmt::print(stderr, "Failed to store program binary {}: {}\n", path.string(), error.message());
+	}
+}
+
+auto compile(GLuint program, shader_stage const& stage, std::string const& source) -> void {
+	auto const shader{glCreateShader(stage.type)};
+	if (shader == 0) {
+		throw std::runtime_error{fmt::format("Failed to create a shader for {}", stage.path.string())};
+	}
+	auto const* text{source.c_str()};
+	glShaderSource(shader, 1, &text, nullptr);
+	glCompileShader(shader);
+	print_shader_info(shader, stage.path);
+	glAttachShader(program, shader);
+	// Deleted once the program is.
+	glDeleteShader(shader);
+}
+
+} // namespace
+
+auto link_program(GLuint program, std::span<shader_stage const> stages) -> bool {
+	auto const start{std::chrono::steady_clock::now()};
+	auto sources{std::vector<std::string>{}};
+	auto source_hash{uint64_t{0xcbf29ce484222325}};
+	for (auto const& stage : stages) {
+		sources.push_back(read_source(stage.path));
+		source_hash = hash(source_hash, &stage.type, sizeof(stage.type));
+		source_hash = hash(source_hash, sources.back().data(), sources.back().size());
+	}
+	auto const driver_name{driver()};
+	auto const finished{[&](bool success) {
+		auto const elapsed{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)};
+		link_microseconds += static_cast<uint64_t>(elapsed.count());
+		return success;
+	}};
+
+	GLint formats{0};
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats > 0 && !skip_cache && load_binary(program, source_hash, driver_name)) {
+		++programs_loaded;
+		return finished(true);
+	}
+
+	for (size_t i{0}; i < stages.size(); ++i) {
+		compile(program, stages[i], sources[i]);
+	}
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(program);
+	print_program_info(program);
+	++programs_compiled;
+	if (!linked(program)) {
+		fmt::print(stderr, "Shader program {} failed to link\n", program);
+		return finished(false);
+	}
+	if (formats > 0) {
+		store_binary(program, source_hash, driver_name);
+	}
+	return finished(true);
+}
+
+auto ignore_cached_programs() -> void {
+	skip_cache = true;
+}
+
+auto program_stats() -> program_cache_stats {
+	return program_cache_stats{
+		.loaded = programs_loaded,
+		.compiled = programs_compiled,
+		.milliseconds = static_cast<double>(link_microseconds) / 1000.0,
+	};
+}
+
+} // namespace gravity::gl
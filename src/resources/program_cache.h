@@ -0,0 +1,36 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include "opengl.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace gravity::gl {
+
+struct shader_stage {
+	GLenum type;
+	std::filesystem::path path;
+};
+
+// Links program from the stage sources, or loads the binary an earlier run stored for the same
+// sources and driver. Touches no cached state, so any thread with a shared context may call it.
+// Returns false if linking failed, the logs are printed.
+auto link_program(GLuint program, std::span<shader_stage const> stages) -> bool;
+
+// Compiles every program from source, while still storing the binaries, to measure a cold start.
+auto ignore_cached_programs() -> void;
+
+struct program_cache_stats {
+	size_t loaded{0};
+	size_t compiled{0};
+	// Spent in link_program across all threads.
+	double milliseconds{0.0};
+};
+
+[[nodiscard]] auto program_stats() -> program_cache_stats;
+
+} // namespace gravity::gl
+
+#endif
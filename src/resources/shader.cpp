@@ -1,12 +1,13 @@
 #include "shader.h"
 
+#include "gl_state.h"
 #include "opengl.h"
+#include "program_cache.h"
 
 #include <fmt/format.h>
-#include <fstream>
+#include <array>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <sstream>
 #include <stdexcept>
 namespace gravity {
 
@@ -23,18 +24,25 @@ shader_program::shader_program(std::filesystem::path const& vert_path, std::file
 	{
     vertex_path = vert_path;
 	fragment_path = frag_path;
-	vertex_shader = load_shader(vertex_path, GL_VERTEX_SHADER);
-	fragment_shader = load_shader(frag_path, GL_FRAGMENT_SHADER);
-	print_info();
-    glLinkProgram(handle);
-	glUseProgram(handle);
+	auto const stages{std::array{gl::shader_stage{GL_VERTEX_SHADER, vertex_path}, gl::shader_stage{GL_FRAGMENT_SHADER, fragment_path}}};
+	if (!gl::link_program(handle, stages)) {
+		throw std::runtime_error{fmt::format("Failed to link {} and {}", vertex_path.string(), fragment_path.string())};
+	}
+	gl::use_program(handle);
+}
+
+shader_program::shader_program(GLuint linked)
+	: handle{linked} {
+	if (!glIsProgram(handle)) {
+		throw std::runtime_error{"Shader program is not created"};
+	}
 }
 
 shader_program::~shader_program() {
 	
 	glDeleteProgram(handle);
-	vertex_shader = 0;
-	fragment_shader = 0;
+	// The name may be handed out again while the cache still holds it.
+	gl::invalidate_state();
 	handle = 0;
 }
 
@@ -48,21 +56,18 @@ auto shader_program::load_compute_shader(std::filesystem::path const& path) ->
         fmt::print(stderr, "Shader {} is already linked\n", handle);
         return;
     }
-    compute_shader = load_shader(path, GL_COMPUTE_SHADER);
-    glLinkProgram(handle);
-	glGetProgramiv(handle, GL_LINK_STATUS, &val);
-	if (val == GL_FALSE) {
-        fmt::print(stderr, "Shader {} failed to link\n", handle);
+    auto const stage{gl::shader_stage{GL_COMPUTE_SHADER, path}};
+    if (!gl::link_program(handle, std::span{&stage, 1})) {
+        throw std::runtime_error{fmt::format("Failed to link {}", path.string())};
     }
-    glUseProgram(handle);
-	print_info();
+    gl::use_program(handle);
 	if (!glIsProgram(handle)) {
         throw std::runtime_error{"Shader program is not created"};
     }
 }
 
 auto shader_program::use() const -> void {
-	glUseProgram(handle);
+	gl::use_program(handle);
 }
 
 auto shader_program::get_attrib_location(std::string const& name) -> GLint {
@@ -87,47 +92,4 @@ auto shader_program::get_uniform_location(std::string const& name) -> GLint {
 	return location;
 }
 
-auto shader_program::load_shader(std::filesystem::path const& file_name, int shader_type) const -> GLuint {
-	GLuint shader_id{glCreateShader(shader_type)};
-	if (shader_id == 0) {
-		throw std::runtime_error{"Failed to initialize fragment shader"};
-	}
-	std::ifstream shader_file{file_name};
-	if (!shader_file || !shader_file.is_open()) {
-		throw std::runtime_error{fmt::format("Failed to read fragment shader {}", file_name.string())};
-	}
-	std::string const data{(std::istreambuf_iterator<char>(shader_file)), std::istreambuf_iterator<char>()};
-	auto const source{data.c_str()};
-	glShaderSource(shader_id, 1, &source, nullptr);
-	glCompileShader(shader_id);
-	print_shader_info(shader_id, file_name);
-	glAttachShader(handle, shader_id);
-    glDeleteShader(shader_id);
-	return shader_id;
-}
-
-auto shader_program::print_shader_info(GLuint shader, std::filesystem::path const& file_name) const -> void {
-	GLint info_log_length{0};
-	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
-	if (info_log_length > 2) {
-		fmt::print(stderr, "[From {}:]\n", file_name.string());
-		std::string info_log{};
-		info_log.resize(info_log_length);
-		glGetShaderInfoLog(shader, info_log_length, NULL, info_log.data());
-		fmt::print(stderr, "{}\n", info_log);
-	}
-}
-
-auto shader_program::print_info() const -> void {
-	GLint log_length;
-	glGetProgramiv(handle, GL_INFO_LOG_LENGTH, &log_length);
-	if (log_length > 2) {
-		fmt::print(stderr, "Shader program {}:\n", handle);
-		std::string info_log{};
-		info_log.resize(log_length);
-		glGetProgramInfoLog(handle, log_length, nullptr, info_log.data());
-		fmt::print(stderr, "{}\n", info_log);
-	}
-}
-	
 } // namespace gravity
\ No newline at end of file
@@ -20,6 +20,8 @@ public:
 	auto operator=(shader_program&&) -> shader_program& = delete;
 	shader_program();
 	explicit shader_program(std::filesystem::path const& vert_path, std::filesystem::path const& frag_path);
+	// Takes ownership of a program linked elsewhere, e.g. by a background_compiler.
+	explicit shader_program(GLuint linked);
 
 	~shader_program() noexcept;
 	auto load_compute_shader(std::filesystem::path const& path) -> void;
@@ -65,15 +67,9 @@ public:
 	
 
 private:
-	auto load_shader(std::filesystem::path const& file_name, int shader_type) const -> GLuint;
-	auto print_shader_info(GLuint shader, std::filesystem::path const& file_name) const -> void;
-	auto print_info() const -> void;
 	std::filesystem::path vertex_path{};
 	std::filesystem::path fragment_path{};
 	GLuint handle{0};
-	GLuint vertex_shader{0};
-	GLuint fragment_shader{0};
-	GLuint compute_shader{0};
 	std::unordered_map<std::string, GLint> attrib_name_to_location{};
 	std::unordered_map<std::string, GLint> uniform_name_to_location{};
 };
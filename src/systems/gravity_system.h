@@ -8,8 +8,12 @@ struct gravity_constant {
     float value;
 };
 
+// Brute force O(N^2) CPU solver, accumulate_forces followed by integrate.
 auto update(entt::registry& registry, float delta_time) -> void;
 
+auto accumulate_forces(entt::registry& registry, float delta_time) -> void;
+auto integrate(entt::registry& registry, float delta_time) -> void;
+
 } // namespace gravity::gravity_system
 
-#endif
\ No newline at end of file
+#endif
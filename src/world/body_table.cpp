@@ -0,0 +1,131 @@
+#include "body_table.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <trace.h>
+
+namespace gravity {
+
+namespace {
+constexpr auto invalid_slot{SIZE_MAX};
+constexpr size_t body_bytes{sizeof(glm::vec4)};
+} // namespace
+
+body_table::body_table(compute& transfers, size_t capacity)
+	: transfers{transfers}
+	, slot_capacity{std::max(capacity, size_t{1})} {
+	for (unsigned int binding{0}; binding < handles.size(); ++binding) {
+		storage[binding] = gl::buffer::adopt(transfers.generate_buffer(slot_capacity * body_bytes, binding, GL_DYNAMIC_COPY));
+		handles[binding] = storage[binding].get();
+	}
+}
+
+auto body_table::id(entt::entity entity) -> size_t {
+	return static_cast<size_t>(entt::to_integral(entity) & entt::entt_traits<entt::entity>::entity_mask);
+}
+
+auto body_table::contains(entt::entity entity) const -> bool {
+	auto const i{id(entity)};
+	return i < slots.size() && slots[i] != invalid_slot && entities[slots[i]] == entity;
+}
+
+auto body_table::slot(entt::entity entity) const -> size_t {
+	if (!contains(entity)) {
+		throw std::runtime_error{fmt::format("Entity {} has no body slot", entt::to_integral(entity))};
+	}
+	return slots[id(entity)];
+}
+
+auto body_table::assign(std::span<entt::entity const> bodies, std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities) -> void {
+	TRACE_FUNCTION();
+	if (positions.size() != bodies.size() || velocities.size() != bodies.size()) {
+		throw std::runtime_error{"Every body needs a position and a velocity"};
+	}
+	clear();
+	reserve(bodies.size());
+	add_slots(bodies);
+	// A whole scene at once, e.g. straight from a file mapping. Going through the staging ring
+	// would only add a copy and grow its mapped memory.
+	auto const sources{std::array{positions, velocities}};
+	for (size_t i{0}; i < handles.size(); ++i) {
+		gl::bind_buffer(GL_COPY_WRITE_BUFFER, handles[i]);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, 0, static_cast<GLsizeiptr>(sources[i].size_bytes()), sources[i].data());
+	}
+}
+
+auto body_table::append(std::span<entt::entity const> bodies, std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities) -> void {
+	TRACE_FUNCTION();
+	if (positions.size() != bodies.size() || velocities.size() != bodies.size()) {
+		throw std::runtime_error{"Every body needs a position and a velocity"};
+	}
+	auto const first{size()};
+	reserve(first + bodies.size());
+	add_slots(bodies);
+	transfers.write_async<glm::vec4>(handles, first, bodies.size(), [&](std::span<glm::vec4> staged) {
+		std::copy(positions.begin(), positions.end(), staged.begin());
+		std::copy(velocities.begin(), velocities.end(), staged.begin() + static_cast<std::ptrdiff_t>(bodies.size()));
+	});
+}
+
+auto body_table::add_slots(std::span<entt::entity const> bodies) -> void {
+	for (auto const entity : bodies) {
+		auto const i{id(entity)};
+		if (i >= slots.size()) {
+			slots.resize(std::max(i + 1, slots.size() * 2), invalid_slot);
+		}
+		slots[i] = entities.size();
+		entities.push_back(entity);
+	}
+}
+
+auto body_table::remove(entt::entity entity) -> void {
+	auto const removed{slot(entity)};
+	auto const last{size() - 1};
+	if (removed != last) {
+		// The last body may have been written by the compute shaders.
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		for (auto const handle : handles) {
+			gl::bind_buffer(GL_COPY_READ_BUFFER, handle);
+			gl::bind_buffer(GL_COPY_WRITE_BUFFER, handle);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(last * body_bytes), static_cast<GLintptr>(removed * body_bytes), body_bytes);
+		}
+		entities[removed] = entities[last];
+		slots[id(entities[removed])] = removed;
+	}
+	slots[id(entity)] = invalid_slot;
+	entities.pop_back();
+}
+
+auto body_table::clear() -> void {
+	for (auto const entity : entities) {
+		slots[id(entity)] = invalid_slot;
+	}
+	entities.clear();
+}
+
+auto body_table::reserve(size_t count) -> void {
+	if (count <= slot_capacity) {
+		return;
+	}
+	TRACE_FUNCTION();
+	slot_capacity = std::max(count, slot_capacity * 2);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	for (unsigned int binding{0}; binding < handles.size(); ++binding) {
+		auto grown{gl::buffer::adopt(transfers.generate_buffer(slot_capacity * body_bytes, binding, GL_DYNAMIC_COPY))};
+		if (!entities.empty()) {
+			gl::bind_buffer(GL_COPY_READ_BUFFER, handles[binding]);
+			gl::bind_buffer(GL_COPY_WRITE_BUFFER, grown.get());
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(entities.size() * body_bytes));
+		}
+		// Draws recorded this frame may still read the old buffer, it goes once they are done.
+		storage[binding] = std::move(grown);
+		handles[binding] = storage[binding].get();
+	}
+}
+
+auto body_table::read() -> transfer {
+	return transfers.read_async<glm::vec4>(handles, size());
+}
+
+} // namespace gravity
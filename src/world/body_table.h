@@ -0,0 +1,85 @@
+#ifndef BODY_TABLE_H
+#define BODY_TABLE_H
+
+#include "compute.h"
+#include "gl_resources.h"
+
+#include <array>
+#include <cstdint>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+namespace gravity {
+
+// The storage buffers the compute shaders and the instanced renderer read, positions at binding 0
+// and velocities at binding 1, in the std430 layout of particle_buffers. Slots mirror the particle
+// group (see particles.h): bodies are appended at the end and a removed body is replaced by the last
+// one, so adding or removing k bodies costs O(k) on both sides. Capacity grows geometrically by
+// copying on the GPU, the buffers keep their bindings.
+class body_table {
+public:
+	explicit body_table(compute& transfers, size_t capacity = 1024);
+	body_table(body_table const&) = delete;
+	auto operator=(body_table const&) -> body_table& = delete;
+	body_table(body_table&&) = delete;
+	auto operator=(body_table&&) -> body_table& = delete;
+
+	[[nodiscard]] auto size() const -> size_t {
+		return entities.size();
+	}
+	[[nodiscard]] auto capacity() const -> size_t {
+		return slot_capacity;
+	}
+	[[nodiscard]] auto positions() const -> unsigned int {
+		return handles[0];
+	}
+	[[nodiscard]] auto velocities() const -> unsigned int {
+		return handles[1];
+	}
+	[[nodiscard]] auto buffers() const -> std::span<unsigned int const> {
+		return handles;
+	}
+	[[nodiscard]] auto contains(entt::entity entity) const -> bool;
+	[[nodiscard]] auto slot(entt::entity entity) const -> size_t;
+
+	// Replaces every body, entities are in slot order. Uploaded without staging, for whole scenes.
+	auto assign(std::span<entt::entity const> bodies, std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities) -> void;
+	// Appends bodies after the current ones.
+	auto append(std::span<entt::entity const> bodies, std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities) -> void;
+	// Moves the last body into the slot of entity, call right before it leaves the particle group.
+	auto remove(entt::entity entity) -> void;
+	auto clear() -> void;
+	// Grows to at least count bodies, keeping the current ones.
+	auto reserve(size_t count) -> void;
+
+	// Overwrites every body with fill(positions, velocities), straight in the staging memory.
+	template <typename Fill>
+	auto update(Fill&& fill) -> transfer {
+		auto const count{size()};
+		return transfers.write_async<glm::vec4>(handles, 0, count, [&](std::span<glm::vec4> staged) {
+			fill(staged.first(count), staged.subspan(count));
+		});
+	}
+	// Reads every body back, positions then velocities.
+	auto read() -> transfer;
+
+private:
+	static auto id(entt::entity entity) -> size_t;
+	// Gives bodies the slots after the current ones.
+	auto add_slots(std::span<entt::entity const> bodies) -> void;
+
+	compute& transfers;
+	std::array<gl::buffer, 2> storage{};
+	// The names of storage, for the transfers.
+	std::array<unsigned int, 2> handles{};
+	size_t slot_capacity{0};
+	std::vector<entt::entity> entities{};
+	// Indexed by entity id.
+	std::vector<size_t> slots{};
+};
+
+} // namespace gravity
+
+#endif
@@ -10,21 +10,23 @@ compute::compute(std::filesystem::path const& path)
 	compute_shader.load_compute_shader(path);
 }
 
+compute::compute(GLuint linked)
+	: compute_shader{linked} {}
+
 auto compute::generate_buffer(size_t size, unsigned int binding, GLenum usage) -> unsigned int {
 	compute_shader.use();
 	GLuint ssbo;
 	glGenBuffers(1, &ssbo);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
+	gl::bind_buffer(GL_SHADER_STORAGE_BUFFER, ssbo);
 	glBufferData(GL_SHADER_STORAGE_BUFFER, size, (void*)nullptr, usage);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, ssbo);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	gl::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, binding, ssbo);
 	return ssbo;
 }
 
 auto compute::bind_buffer(unsigned int handle, unsigned int binding) -> void {
 	compute_shader.use();
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, handle);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, handle);
+	gl::bind_buffer(GL_SHADER_STORAGE_BUFFER, handle);
+	gl::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, binding, handle);
 }
 
 auto compute::buffer_size() const -> size_t {
@@ -34,11 +36,23 @@ auto compute::buffer_size() const -> size_t {
 }
 
 auto compute::clear_buffer(unsigned int handle) -> void {
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, handle);
+	gl::bind_buffer(GL_SHADER_STORAGE_BUFFER, handle);
 	GLint usage;
 	glGetBufferParameteriv(GL_SHADER_STORAGE_BUFFER, GL_BUFFER_USAGE, &usage);
 	glBufferData(GL_SHADER_STORAGE_BUFFER, 0, (void*)nullptr, usage);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+auto compute::staging() -> staging_ring& {
+	if (!ring) {
+		ring = std::make_unique<staging_ring>();
+	}
+	return *ring;
+}
+
+auto compute::end_transfer_frame() -> void {
+	if (ring) {
+		ring->end_frame();
+	}
 }
 
 auto compute::use() -> void {
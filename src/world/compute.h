@@ -1,10 +1,16 @@
 #ifndef COMPUTE_H
 #define COMPUTE_H
 
+#include "gl_state.h"
 #include "shader.h"
+#include "staging_ring.h"
 
+#include <algorithm>
 #include <filesystem>
+#include <memory>
+#include <span>
 #include <unordered_map>
+#include <vector>
 #include <fmt/core.h>
 
 namespace gravity {
@@ -17,9 +23,15 @@ struct compute_vec3 {
 class compute {
 	shader_program compute_shader{};
 	std::unordered_map<unsigned int, unsigned int> handles_to_bindings{};
+	// Created on the first asynchronous transfer.
+	std::unique_ptr<staging_ring> ring{};
+
+	auto staging() -> staging_ring&;
 
 public:
 	explicit compute(std::filesystem::path const& source);
+	// Takes ownership of a compute program linked elsewhere.
+	explicit compute(GLuint linked);
 
 	auto generate_buffer(size_t size, unsigned int binding, GLenum usage) -> unsigned int;
 	
@@ -29,15 +41,19 @@ public:
 	}
 
 	template<typename T>
-	auto regenerate_buffer(std::vector<T> const& buffer, unsigned int handle) -> void {
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, handle);
+	auto regenerate_buffer(std::span<T const> buffer, unsigned int handle) -> void {
+		gl::bind_buffer(GL_SHADER_STORAGE_BUFFER, handle);
 		GLint usage;
 		glGetBufferParameteriv(GL_SHADER_STORAGE_BUFFER, GL_BUFFER_USAGE, &usage);
 		if (buffer.size() * sizeof(T) > buffer_size()) {
 			fmt::print("Regenerating buffer {}\n", handle);
-			glBufferData(GL_SHADER_STORAGE_BUFFER, buffer.size() * sizeof(T), &buffer[0], usage);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, buffer.size() * sizeof(T), buffer.data(), usage);
 		}
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	template<typename T>
+	auto regenerate_buffer(std::vector<T> const& buffer, unsigned int handle) -> void {
+		regenerate_buffer(std::span<T const>{buffer}, handle);
 	}
 
 	auto bind_buffer(unsigned int handle, unsigned int binding) -> void;
@@ -49,25 +65,49 @@ public:
 
 	auto use() -> void;
 	template <typename T>
-	auto upload(std::vector<T> const& buffer, unsigned int handle) -> void {
+	auto upload(std::span<T const> buffer, unsigned int handle) -> void {
         if (buffer.empty()) return;
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, handle);
+		gl::bind_buffer(GL_SHADER_STORAGE_BUFFER, handle);
 		if (buffer.size() * sizeof(T) > buffer_size()) {
 			fmt::print("Buffer to upload is larger than storage buffer {}\n", handle);
-			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 			return;
 		} else {
-			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, buffer.size() * sizeof(T), &buffer[0]);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, buffer.size() * sizeof(T), buffer.data());
 		}
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 	}
 
+	template <typename T>
+	auto upload(std::vector<T> const& buffer, unsigned int handle) -> void {
+		upload(std::span<T const>{buffer}, handle);
+	}
+
+	// Asynchronous transfers through the staging ring, each target or source holds count elements
+	// back to back in the staging memory. Targets must already hold first + count elements.
+	template <typename T, typename Fill>
+	auto write_async(std::span<unsigned int const> targets, size_t first, size_t count, Fill&& fill) -> transfer {
+		return staging().write(targets, first * sizeof(T), count * sizeof(T), [&](std::span<std::byte> bytes) {
+			fill(std::span<T>{reinterpret_cast<T*>(bytes.data()), bytes.size() / sizeof(T)});
+		});
+	}
+
+	template <typename T>
+	auto write_async(std::span<T const> buffer, unsigned int handle) -> transfer {
+		return staging().write(std::span{&handle, 1}, 0, std::as_bytes(buffer));
+	}
+
+	template <typename T>
+	auto read_async(std::span<unsigned int const> sources, size_t count) -> transfer {
+		return staging().read(sources, count * sizeof(T));
+	}
+
+	// Fences the transfers since the last call, once per frame.
+	auto end_transfer_frame() -> void;
+
 	template <typename T>
 	auto read(std::vector<T>& buffer, unsigned int handle) -> void {
         if (buffer.empty()) return;
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, handle);
+		gl::bind_buffer(GL_SHADER_STORAGE_BUFFER, handle);
 		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, buffer.size() * sizeof(T), &buffer[0]);
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 	}
 
 	auto dispatch(unsigned int x, unsigned int y, unsigned int z) -> void;
@@ -2,6 +2,7 @@
 #define MODEL_H
 
 #include "mesh.h"
+#include <memory>
 #include <vector>
 
 namespace gravity {
@@ -14,6 +15,9 @@ public:
     std::vector<mesh> meshes{};
     
 };
+
+// Geometry shared by every entity drawn with it, see shape.h.
+using shared_model = std::shared_ptr<model const>;
     
 } // namespace gravity
 
@@ -0,0 +1,96 @@
+#include "particles.h"
+
+#include "components.h"
+
+#include <algorithm>
+#include <parallel.h>
+#include <trace.h>
+
+namespace gravity {
+
+namespace {
+constexpr size_t block_size{1 << 16};
+
+auto particle_group(entt::registry& registry) {
+	return registry.group<transform_component, physics_component>();
+}
+
+// Calls body(slot) in parallel blocks.
+template <typename Body>
+auto for_each_slot(size_t count, Body&& body) -> void {
+	parallel_for((count + block_size - 1) / block_size, [&](size_t block) {
+		auto const end{std::min(count, (block + 1) * block_size)};
+		for (auto slot{block * block_size}; slot < end; ++slot) {
+			body(slot);
+		}
+	});
+}
+} // namespace
+
+auto make_particle_group(entt::registry& registry) -> void {
+	static_cast<void>(particle_group(registry));
+}
+
+auto particle_count(entt::registry& registry) -> size_t {
+	return particle_group(registry).size();
+}
+
+auto particle_entities(entt::registry& registry) -> std::span<entt::entity const> {
+	auto group = particle_group(registry);
+	return {group.data(), group.size()};
+}
+
+auto pack_particles(entt::registry& registry, std::span<glm::vec4> positions, std::span<glm::vec4> velocities) -> void {
+	TRACE_FUNCTION();
+	auto group = particle_group(registry);
+	auto const count{std::min({group.size(), positions.size(), velocities.size()})};
+	auto const* transforms{group.raw<transform_component>()};
+	auto const* physics{group.raw<physics_component>()};
+	for_each_slot(count, [&](size_t slot) {
+		positions[slot] = glm::vec4{transforms[slot].position, physics[slot].mass};
+		velocities[slot] = glm::vec4{physics[slot].velocity, 0.f};
+	});
+}
+
+auto pack_particles(entt::registry& registry, particle_buffers& buffers) -> void {
+	auto const count{particle_count(registry)};
+	buffers.positions.resize(count);
+	buffers.velocities.resize(count);
+	pack_particles(registry, buffers.positions, buffers.velocities);
+}
+
+auto unpack_particles(particle_buffers const& buffers, entt::registry& registry) -> void {
+	TRACE_FUNCTION();
+	auto group = particle_group(registry);
+	auto* transforms{group.raw<transform_component>()};
+	auto* physics{group.raw<physics_component>()};
+	for_each_slot(std::min(group.size(), buffers.size()), [&](size_t slot) {
+		transforms[slot].position = glm::vec3{buffers.positions[slot]};
+		physics[slot].velocity = glm::vec3{buffers.velocities[slot]};
+	});
+}
+
+auto create_particles(entt::registry& registry, std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities) -> std::vector<entt::entity> {
+	TRACE_FUNCTION();
+	make_particle_group(registry);
+	auto entities{std::vector<entt::entity>(positions.size())};
+	registry.reserve<transform_component, physics_component, instanced_component>(registry.size<transform_component>() + entities.size());
+	registry.create(entities.begin(), entities.end());
+
+	auto transforms{std::vector<transform_component>(entities.size())};
+	auto physics{std::vector<physics_component>(entities.size())};
+	parallel_for((entities.size() + block_size - 1) / block_size, [&](size_t block) {
+		auto const end{std::min(entities.size(), (block + 1) * block_size)};
+		for (auto i{block * block_size}; i < end; ++i) {
+			transforms[i] = transform_component{glm::vec3{positions[i]}};
+			physics[i] = physics_component{glm::vec3{velocities[i]}, positions[i].w};
+		}
+	});
+	// Each body joins the end of the group as its physics is inserted, so the slots follow the input.
+	registry.insert<transform_component>(entities.begin(), entities.end(), transforms.begin(), transforms.end());
+	registry.insert<physics_component>(entities.begin(), entities.end(), physics.begin(), physics.end());
+	registry.insert<instanced_component>(entities.begin(), entities.end());
+	return entities;
+}
+
+} // namespace gravity
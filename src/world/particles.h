@@ -0,0 +1,42 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+namespace gravity {
+
+// Bodies in the std430 layout of the compute shaders. position.w is the mass.
+struct particle_buffers {
+	std::vector<glm::vec4> positions{};
+	std::vector<glm::vec4> velocities{};
+
+	[[nodiscard]] auto size() const -> size_t {
+		return positions.size();
+	}
+};
+
+// Owns the transform and physics pools so every body sits at the front of both, in the same order.
+// The index of a body in the group is its slot in the storage buffers: new bodies are appended and
+// a removed body is replaced by the last one. Must exist before bodies are added, create_particles
+// makes sure it does.
+auto make_particle_group(entt::registry& registry) -> void;
+[[nodiscard]] auto particle_count(entt::registry& registry) -> size_t;
+// The body in each slot, valid until bodies are added or removed.
+[[nodiscard]] auto particle_entities(entt::registry& registry) -> std::span<entt::entity const>;
+// Packs every body in slot order straight from the group, positions and velocities hold
+// particle_count elements, e.g. staging memory.
+auto pack_particles(entt::registry& registry, std::span<glm::vec4> positions, std::span<glm::vec4> velocities) -> void;
+// Packs every body in slot order, reusing the storage of buffers.
+auto pack_particles(entt::registry& registry, particle_buffers& buffers) -> void;
+// Writes buffers back to the bodies they were packed from.
+auto unpack_particles(particle_buffers const& buffers, entt::registry& registry) -> void;
+// Creates an instanced body per element in bulk, appended to the slots in the same order.
+// Returns the entities in that order.
+auto create_particles(entt::registry& registry, std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities) -> std::vector<entt::entity>;
+
+} // namespace gravity
+
+#endif
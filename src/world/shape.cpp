@@ -1,102 +1,130 @@
 #include "shape.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <unordered_map>
 #include <utility>
 
 namespace gravity::shape {
 
-auto create_face(glm::vec3 const normal, unsigned int resolution) -> mesh {
-	auto const axis_a{glm::vec3(normal.y, normal.z, normal.x)};
-	auto const axis_b{glm::cross(normal, axis_a)};
-	auto vertices{std::vector<vertex>{resolution * resolution}};
-
-	auto triangles{std::vector<unsigned int>((resolution - 1) * (resolution - 1) * 6)};
-
-	auto triangle_index{0};
-
-	for (size_t y = 0; y < resolution; y++) {
-		for (size_t x = 0; x < resolution; x++) {
-			auto const vertex_index{static_cast<unsigned int>(x + y * resolution)};
-			auto const t{glm::vec2(x, y) / static_cast<float>(resolution - 1)};
-			auto const point{normal + axis_a * (2 * t.x - 1) + axis_b * (2 * t.y - 1)};
-			vertices[vertex_index].position = point;
-			if (x != resolution - 1 && y != resolution - 1) {
-				triangles[triangle_index + 0] = vertex_index;
-				triangles[triangle_index + 1] = vertex_index + resolution + 1;
-				triangles[triangle_index + 2] = vertex_index + resolution;
-				triangles[triangle_index + 3] = vertex_index;
-				triangles[triangle_index + 4] = vertex_index + 1;
-				triangles[triangle_index + 5] = vertex_index + resolution + 1;
-				triangle_index += 6;
-			}
-		}
-	}
+namespace {
 
-	return mesh{std::move(triangles), std::move(vertices)};
+using lattice_point = std::array<int, 3>;
+
+// The six faces of the cube, each spanned by axis_a and axis_b.
+constexpr auto face_normals{std::array<lattice_point, 6>{{
+	{0, 1, 0},  // UP
+	{0, -1, 0}, // DOWN
+	{1, 0, 0},  // RIGHT
+	{-1, 0, 0}, // LEFT
+	{0, 0, 1},  // FORWARD
+	{0, 0, -1}, // BACKWARD
+}}};
+
+auto cross(lattice_point const& a, lattice_point const& b) -> lattice_point {
+	return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
 }
 
-auto generate_faces(unsigned int resolution) -> std::vector<mesh> {
-	if (faces.contains(resolution)) {
-		return faces[resolution];
-	}
-	auto meshes{std::vector<mesh>{}};
-
-	auto normals = std::vector<glm::vec3>{
-		{0, 1, 0},  // UP
-		{0, -1, 0}, // DOWN
-		{1, 0, 0},  // RIGHT
-		{-1, 0, 0}, //LEFT
-		{0, 0, 1},  // FORWARD
-		{0, 0, -1}, // BACKWARD
+} // namespace
+
+auto build_sphere(unsigned int resolution) -> mesh {
+	// Points are placed on an integer lattice over the cube, so neighbouring faces produce the
+	// same key for their shared edge and corner vertices and those are stored once.
+	auto const steps{static_cast<int>(resolution) - 1};
+	auto const key = [&](lattice_point const& p) {
+		auto const side{static_cast<uint64_t>(2 * steps + 1)};
+		return (static_cast<uint64_t>(p[0] + steps) * side + static_cast<uint64_t>(p[1] + steps)) * side + static_cast<uint64_t>(p[2] + steps);
 	};
 
-	for (auto const& normal : normals) {
-		auto mesh{create_face(glm::normalize(normal), resolution)};
-		meshes.emplace_back(mesh);
+	auto vertices{std::vector<vertex>{}};
+	auto triangles{std::vector<unsigned int>{}};
+	vertices.reserve(6 * resolution * resolution);
+	triangles.reserve(6 * static_cast<size_t>(steps * steps) * 6);
+	auto welded{std::unordered_map<uint64_t, unsigned int>{}};
+	auto face{std::vector<unsigned int>(resolution * resolution)};
+	for (auto const& normal : face_normals) {
+		auto const axis_a{lattice_point{normal[1], normal[2], normal[0]}};
+		auto const axis_b{cross(normal, axis_a)};
+		for (int y{0}; y <= steps; ++y) {
+			for (int x{0}; x <= steps; ++x) {
+				auto point{lattice_point{}};
+				for (size_t i{0}; i < point.size(); ++i) {
+					point[i] = normal[i] * steps + axis_a[i] * (2 * x - steps) + axis_b[i] * (2 * y - steps);
+				}
+				auto const [found, inserted]{welded.try_emplace(key(point), static_cast<unsigned int>(vertices.size()))};
+				if (inserted) {
+					auto const position{glm::normalize(glm::vec3{static_cast<float>(point[0]), static_cast<float>(point[1]), static_cast<float>(point[2])})};
+					vertices.push_back({.position = position, .normal = position, .uv = {}});
+				}
+				face[static_cast<size_t>(x + y * static_cast<int>(resolution))] = found->second;
+			}
+		}
+		for (unsigned int y{0}; y + 1 < resolution; ++y) {
+			for (unsigned int x{0}; x + 1 < resolution; ++x) {
+				auto const i{x + y * resolution};
+				triangles.insert(triangles.end(), {
+					face[i], face[i + resolution + 1], face[i + resolution],
+					face[i], face[i + 1], face[i + resolution + 1],
+				});
+			}
+		}
 	}
-
-	faces[resolution] = meshes;
-
-	return meshes;
+	return mesh{std::move(triangles), std::move(vertices)};
 }
 
-auto create_plane() -> model {
-	std::vector<vertex> vertices{
-		{.position = {0.5f, 0.5f, 0.0f}, .normal = {}, .uv = {}},   // top right
-		{.position = {0.5f, -0.5f, 0.0f}, .normal = {}, .uv = {}},  // bottom right
-		{.position = {-0.5f, -0.5f, 0.0f}, .normal = {}, .uv = {}}, // bottom left
-		{.position = {-0.5f, 0.5f, 0.0f}, .normal = {}, .uv = {}},  // top left
-	};
+namespace {
 
-	auto indices{std::vector<unsigned int>{0, 1, 3, 1, 2, 3}};
-	auto m{mesh{std::move(indices), std::move(vertices)}};
-	m.generate_buffer();
-	auto meshes{std::vector{m}};
-	return model{std::move(meshes)};
+auto cache() -> std::map<std::pair<kind, int>, std::weak_ptr<model const>>& {
+	static auto models{std::map<std::pair<kind, int>, std::weak_ptr<model const>>{}};
+	return models;
 }
 
-auto create_sphere(int resolution, float radius) -> model {
-	auto sphere_meshes{generate_faces(resolution)};
-
-	for (auto&& mesh : sphere_meshes) {
-		for (auto&& ver : mesh.vertices) {
-			ver.position = glm::normalize(ver.position) * radius;
-		}
+template <typename Build>
+auto cached(kind shape, int resolution, Build&& build) -> shared_model {
+	auto& entry{cache()[{shape, resolution}]};
+	if (auto shared{entry.lock()}) {
+		return shared;
+	}
+	auto meshes{build()};
+	for (auto&& mesh : meshes) {
 		mesh.generate_buffer();
 	}
+	auto shared{std::make_shared<model const>(std::move(meshes))};
+	entry = shared;
+	return shared;
+}
 
-	return model{std::move(sphere_meshes)};
+} // namespace
+
+auto create_plane() -> shared_model {
+	return cached(kind::plane, 0, [] {
+		std::vector<vertex> vertices{
+			{.position = {0.5f, 0.5f, 0.0f}, .normal = {}, .uv = {}},   // top right
+			{.position = {0.5f, -0.5f, 0.0f}, .normal = {}, .uv = {}},  // bottom right
+			{.position = {-0.5f, -0.5f, 0.0f}, .normal = {}, .uv = {}}, // bottom left
+			{.position = {-0.5f, 0.5f, 0.0f}, .normal = {}, .uv = {}},  // top left
+		};
+
+		auto indices{std::vector<unsigned int>{0, 1, 3, 1, 2, 3}};
+		auto meshes{std::vector<mesh>{}};
+		meshes.emplace_back(std::move(indices), std::move(vertices));
+		return meshes;
+	});
 }
 
-auto regenerate_sphere(model& sphere, int new_resolution, float radius) -> void {
-	auto new_meshes{generate_faces(new_resolution)};
-	auto combination{std::vector<std::pair<mesh, mesh>>{}};
+auto create_sphere(int resolution) -> shared_model {
+	return cached(kind::sphere, resolution, [&] {
+		auto meshes{std::vector<mesh>{}};
+		meshes.push_back(build_sphere(static_cast<unsigned int>(resolution)));
+		return meshes;
+	});
+}
 
-	for(size_t i{0}; i < new_meshes.size(); ++i) {
-		for (auto&& ver: new_meshes[i].vertices) {
-			ver.position = glm::normalize(ver.position) * radius;
-		}
-		sphere.meshes[i].update_buffer(std::move(new_meshes[i].indices), std::move(new_meshes[i].vertices));
-	}
+auto cached_models() -> size_t {
+	return static_cast<size_t>(std::count_if(cache().begin(), cache().end(), [](auto const& entry) { return !entry.second.expired(); }));
 }
 
 } // namespace gravity::shape
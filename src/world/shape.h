@@ -4,8 +4,6 @@
 #include "mesh.h"
 #include "model.h"
 
-#include <glm/glm.hpp> // vec3, vec2
-#include <unordered_map>
 #include <vector>
 
 namespace gravity::shape {
@@ -13,18 +11,23 @@ namespace gravity::shape {
 auto constexpr  max_sphere_resolution{25};
 auto constexpr  min_sphere_resolution{2};
 
+enum class kind {
+	plane,
+	sphere,
+};
 
-auto create_face(glm::vec3 const normal, unsigned int resolution) -> mesh;
+// A unit sphere projected from a cube with resolution vertices along each edge, as one
+// indexed mesh with the seams between the faces welded.
+auto build_sphere(unsigned int resolution) -> mesh;
 
-static auto faces{std::unordered_map<unsigned int, std::vector<mesh>>{}};
+// Uploaded once per kind and resolution and shared by every caller, the cache only keeps
+// geometry alive while a handle to it does. Spheres have unit radius, scale them when drawing.
+auto create_plane() -> shared_model;
 
-auto generate_faces(unsigned int resolution) -> std::vector<mesh>;
+auto create_sphere(int resolution) -> shared_model;
 
-auto create_plane() -> model;
-
-auto create_sphere(int resolution, float radius) -> model;
-
-auto regenerate_sphere(model& sphere, int new_resolution, float radius) -> void;
+// Models currently held by the cache.
+auto cached_models() -> size_t;
 
 } // namespace gravity::shape
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,120 @@
+#include "spawn.h"
+
+#include "components.h"
+#include "gravity_system.h"
+#include "particles.h"
+#include "randomness.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <parallel.h>
+#include <string_view>
+#include <trace.h>
+
+namespace gravity::spawn {
+
+namespace {
+constexpr float planet_mass{1000.f};
+constexpr float moon_mass{1.f};
+constexpr float asteroid_mass{0.01f};
+constexpr size_t block_size{4096};
+
+// Fills the particle arrays with sample(engine) for every body, each drawing from its own Philox stream.
+template <typename Sampler>
+auto generate(size_t amount, uint64_t seed, float mass, Sampler const& sample) -> particle_buffers {
+	auto bodies{particle_buffers{}};
+	// Room for a central body.
+	bodies.positions.reserve(amount + 1);
+	bodies.velocities.reserve(amount + 1);
+	bodies.positions.resize(amount);
+	bodies.velocities.resize(amount);
+	parallel_for((amount + block_size - 1) / block_size, [&](size_t block) {
+		auto const end{std::min(amount, (block + 1) * block_size)};
+		for (auto i{block * block_size}; i < end; ++i) {
+			auto engine{random::philox{seed, i}};
+			auto const body{sample(engine)};
+			bodies.positions[i] = glm::vec4{body.position, mass};
+			bodies.velocities[i] = glm::vec4{body.velocity, 0.f};
+		}
+	});
+	return bodies;
+}
+
+// Appends a body at rest in the origin and creates every body in one batch, the central body last
+// so the instanced ones start at slot 0. Returns the central body, without instanced_component.
+auto create_with_center(entt::registry& registry, particle_buffers& bodies, float center_mass, std::string_view name) -> entt::entity {
+	bodies.positions.emplace_back(glm::vec3{0.f}, center_mass);
+	bodies.velocities.emplace_back(0.f);
+	auto const center{create_particles(registry, bodies.positions, bodies.velocities).back()};
+	registry.remove<instanced_component>(center);
+	registry.emplace<name_component>(center, name);
+	return center;
+}
+} // namespace
+
+auto moon_system(entt::registry& registry) -> moon_system_bodies {
+	TRACE_FUNCTION();
+	registry.clear();
+
+	auto const planet = registry.create();
+	auto const moon = registry.create();
+	registry.emplace<name_component>(planet, "PLANET");
+	registry.emplace<name_component>(moon, "MOON");
+
+	auto const& planet_physics = registry.emplace<physics_component>(planet, glm::vec3{0.f}, planet_mass);
+	auto& moon_physics = registry.emplace<physics_component>(moon, glm::vec3{0.f}, moon_mass);
+
+	registry.emplace<transform_component>(planet, glm::vec3{0.f});
+	auto& moon_transform = registry.emplace<transform_component>(moon, glm::vec3{10.f, 0.f, 0.f});
+
+	auto const init_velocity{
+		std::sqrt(registry.ctx<const gravity_system::gravity_constant>().value * (planet_physics.mass + 1 / moon_physics.mass) / moon_transform.position.x)};
+	moon_physics.velocity.z = init_velocity;
+	return {planet, moon};
+}
+
+auto asteroids(entt::registry& registry, asteroid_belt const& belt, particle_buffers& packed) -> entt::entity {
+	TRACE_FUNCTION();
+	registry.clear();
+
+	auto const g_c{registry.ctx<const gravity_system::gravity_constant>().value};
+	packed = generate(belt.amount, belt.seed, asteroid_mass, [&](random::philox& engine) {
+		auto const distance{belt.inner_radius + (belt.outer_radius - belt.inner_radius) * static_cast<float>(random::unit_interval(engine))};
+		auto const position{glm::vec3{random::unit_vector(engine)} * distance};
+		auto const init_velocity_direction{glm::normalize(glm::cross(-position, glm::vec3{0.f, 1.f, 0.f}))};
+		auto const init_velocity{std::sqrt(g_c * (planet_mass + 1 / asteroid_mass) / glm::length(position))};
+		return random::phase_point{position, init_velocity_direction * init_velocity};
+	});
+	return create_with_center(registry, packed, planet_mass, "PLANET");
+}
+
+auto galaxy_bodies(entt::registry& registry, galaxy const& options, particle_buffers& packed) -> entt::entity {
+	TRACE_FUNCTION();
+	registry.clear();
+
+	double const g_c{registry.ctx<const gravity_system::gravity_constant>().value};
+	double const mass{options.total_mass};
+	double const scale{options.scale_radius};
+	double const max_radius{options.max_radius};
+	auto const body_mass{options.amount == 0 ? 0.f : options.total_mass / static_cast<float>(options.amount)};
+	switch (options.model) {
+		case galaxy_model::plummer:
+			packed = generate(options.amount, options.seed, body_mass, [&](random::philox& engine) { return random::plummer(engine, scale, mass, g_c, max_radius); });
+			break;
+		case galaxy_model::hernquist:
+			packed = generate(options.amount, options.seed, body_mass, [&](random::philox& engine) { return random::hernquist(engine, scale, mass, g_c, max_radius); });
+			break;
+		case galaxy_model::exponential_disk:
+			packed = generate(options.amount, options.seed, body_mass, [&](random::philox& engine) {
+				return random::exponential_disk(engine, scale, options.scale_height, mass, options.central_mass, g_c, max_radius);
+			});
+			if (options.central_mass > 0.f) {
+				return create_with_center(registry, packed, options.central_mass, "CENTER");
+			}
+			break;
+	}
+	create_particles(registry, packed.positions, packed.velocities);
+	return entt::null;
+}
+
+} // namespace gravity::spawn
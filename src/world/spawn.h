@@ -0,0 +1,58 @@
+#ifndef SPAWN_H
+#define SPAWN_H
+
+#include "particles.h"
+
+#include <cstdint>
+#include <entt/entt.hpp>
+
+namespace gravity::spawn {
+
+struct asteroid_belt {
+	size_t amount{2};
+	float inner_radius{15.f};
+	float outer_radius{25.f};
+	uint64_t seed{0};
+};
+
+enum class galaxy_model : int {
+	plummer,
+	hernquist,
+	exponential_disk,
+};
+
+struct galaxy {
+	galaxy_model model{galaxy_model::plummer};
+	size_t amount{10000};
+	float total_mass{1000.f};
+	float scale_radius{10.f};
+	// Of the exponential disk, thickness of its sech^2 profile.
+	float scale_height{0.5f};
+	// Bodies are resampled beyond this many scale radii.
+	float max_radius{20.f};
+	// Optional body at the centre of the exponential disk, created without instanced_component.
+	float central_mass{0.f};
+	uint64_t seed{0};
+};
+
+struct moon_system_bodies {
+	entt::entity planet;
+	entt::entity moon;
+};
+
+// Scenarios only create the simulated state, renderables are attached by the caller
+// so they can run without a window. They clear the registry first and read the
+// gravity_constant from its context. Random bodies are generated in parallel, body i
+// only depends on the seed and i, so the same seed gives the same bodies on any machine.
+// They are created in one batch and packed is left as pack_particles would fill it,
+// ready to upload.
+
+auto moon_system(entt::registry& registry) -> moon_system_bodies;
+// Returns the planet, the asteroids are tagged with instanced_component.
+auto asteroids(entt::registry& registry, asteroid_belt const& belt, particle_buffers& packed) -> entt::entity;
+// Returns the central body of an exponential disk, entt::null for the other models or without central_mass.
+auto galaxy_bodies(entt::registry& registry, galaxy const& options, particle_buffers& packed) -> entt::entity;
+
+} // namespace gravity::spawn
+
+#endif
@@ -0,0 +1,228 @@
+#include "staging_ring.h"
+
+#include "gl_state.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fmt/core.h>
+#include <stdexcept>
+#include <trace.h>
+
+namespace gravity {
+
+namespace {
+// Keeps every transfer aligned for any element type and for GL_MIN_MAP_BUFFER_ALIGNMENT.
+constexpr size_t transfer_alignment{256};
+constexpr GLuint64 wait_timeout{1'000'000'000};
+constexpr GLbitfield mapping_flags{GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT};
+
+auto align(size_t bytes) -> size_t {
+	return (bytes + transfer_alignment - 1) / transfer_alignment * transfer_alignment;
+}
+} // namespace
+
+auto transfer::ready() const -> bool {
+	return ring == nullptr || ring->signaled(*this);
+}
+
+auto transfer::expired() const -> bool {
+	return ring != nullptr && ring->expired(*this);
+}
+
+auto transfer::wait() const -> bool {
+	return ring == nullptr || ring->finish(*this);
+}
+
+auto transfer::data() const -> std::span<std::byte const> {
+	if (ring == nullptr || !ring->signaled(*this)) {
+		return {};
+	}
+	return {ring->mapped + offset, size};
+}
+
+staging_ring::staging_ring(size_t frames_in_flight, size_t frame_size, size_t max_frame_size)
+	: max_frame_size{align(std::max(max_frame_size, frame_size))}
+	, frames(std::max(frames_in_flight, size_t{2})) {
+	reallocate(align(frame_size));
+}
+
+staging_ring::~staging_ring() {
+	for (auto& frame : frames) {
+		if (frame.fence != nullptr) {
+			glDeleteSync(frame.fence);
+		}
+	}
+	gl::bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	glDeleteBuffers(1, &buffer);
+	gl::invalidate_state();
+}
+
+auto staging_ring::write(std::span<GLuint const> targets, size_t target_offset, std::span<std::byte const> bytes) -> transfer {
+	if (targets.empty() || bytes.empty()) {
+		return {};
+	}
+	auto const bytes_per_target{bytes.size() / targets.size()};
+	if (bytes.size() <= max_frame_size) {
+		auto const staged{allocate(bytes.size())};
+		std::memcpy(mapped + staged.offset, bytes.data(), bytes.size());
+		copy_to(staged, targets, target_offset, bytes_per_target);
+		return staged;
+	}
+	TRACE_FUNCTION();
+	// Each chunk fills a frame, allocating the next one waits for the frame to be free like any other transfer.
+	auto staged{transfer{}};
+	for (size_t i{0}; i < targets.size(); ++i) {
+		for (size_t first{0}; first < bytes_per_target; first += max_frame_size) {
+			auto const size{std::min(max_frame_size, bytes_per_target - first)};
+			staged = allocate(size);
+			std::memcpy(mapped + staged.offset, bytes.data() + i * bytes_per_target + first, size);
+			copy_to(staged, targets.subspan(i, 1), target_offset + first, size);
+		}
+	}
+	return staged;
+}
+
+auto staging_ring::read(std::span<GLuint const> sources, size_t bytes_per_source) -> transfer {
+	if (sources.empty() || bytes_per_source == 0) {
+		return {};
+	}
+	auto const staged{allocate(sources.size() * bytes_per_source)};
+	// The sources were written by compute shaders through shader storage.
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	gl::bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+	for (size_t i{0}; i < sources.size(); ++i) {
+		gl::bind_buffer(GL_COPY_READ_BUFFER, sources[i]);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, static_cast<GLintptr>(staged.offset + i * bytes_per_source), static_cast<GLsizeiptr>(bytes_per_source));
+	}
+	return staged;
+}
+
+auto staging_ring::end_frame() -> void {
+	auto& recorded{frames[current]};
+	if (recorded.used == 0) {
+		return;
+	}
+	recorded.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	current = (current + 1) % frames.size();
+	auto& next{frames[current]};
+	wait_for(next);
+	++next.generation;
+	next.used = 0;
+	// The frame of the readback that grew the ring has been reused, nothing needs the memory anymore.
+	if (frames_until_shrink > 0 && --frames_until_shrink == 0) {
+		reallocate(max_frame_size);
+	}
+}
+
+auto staging_ring::allocate(size_t bytes) -> transfer {
+	auto const aligned{align(bytes)};
+	// Ending the frame may shrink the ring, so it goes first.
+	if (aligned <= frame_size && frames[current].used + aligned > frame_size) {
+		end_frame();
+	}
+	if (aligned > frame_size) {
+		// Only readbacks get past max_frame_size, writes are split into chunks.
+		reallocate(std::max(std::min(std::bit_ceil(aligned), max_frame_size), aligned));
+		frames_until_shrink = frame_size > max_frame_size ? frames.size() : 0;
+	}
+	auto& frame{frames[current]};
+	auto staged{transfer{}};
+	staged.ring = this;
+	staged.frame = current;
+	staged.generation = frame.generation;
+	staged.offset = current * frame_size + frame.used;
+	staged.size = bytes;
+	frame.used += aligned;
+	return staged;
+}
+
+auto staging_ring::copy_to(transfer const& staged, std::span<GLuint const> targets, size_t target_offset, size_t bytes_per_target) -> void {
+	// The mapping is coherent, the CPU writes are visible to the copies without a flush.
+	gl::bind_buffer(GL_COPY_READ_BUFFER, buffer);
+	for (size_t i{0}; i < targets.size(); ++i) {
+		gl::bind_buffer(GL_COPY_WRITE_BUFFER, targets[i]);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(staged.offset + i * bytes_per_target), static_cast<GLintptr>(target_offset), static_cast<GLsizeiptr>(bytes_per_target));
+	}
+}
+
+auto staging_ring::reallocate(size_t new_frame_size) -> void {
+	TRACE_FUNCTION();
+	if (buffer != 0) {
+		fmt::print("Resizing staging ring to {:.1f} MB per frame\n", static_cast<double>(new_frame_size) / (1 << 20));
+		if (frames[current].used > 0) {
+			frames[current].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		for (auto& frame : frames) {
+			wait_for(frame);
+		}
+		gl::bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glDeleteBuffers(1, &buffer);
+		gl::invalidate_state();
+	}
+	for (auto& frame : frames) {
+		++frame.generation;
+		frame.used = 0;
+	}
+	current = 0;
+	frame_size = new_frame_size;
+
+	auto const bytes{static_cast<GLsizeiptr>(frame_size * frames.size())};
+	glGenBuffers(1, &buffer);
+	gl::bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, bytes, nullptr, mapping_flags);
+	mapped = static_cast<std::byte*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes, mapping_flags));
+	if (mapped == nullptr) {
+		throw std::runtime_error{fmt::format("Failed to map a {} MB staging ring", bytes >> 20)};
+	}
+}
+
+auto staging_ring::wait_for(frame_state& frame) -> void {
+	if (frame.fence == nullptr) {
+		return;
+	}
+	auto status{glClientWaitSync(frame.fence, 0, 0)};
+	if (status == GL_TIMEOUT_EXPIRED) {
+		TRACE_SCOPE("Wait for staging frame");
+		do {
+			status = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait_timeout);
+		} while (status == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(frame.fence);
+	frame.fence = nullptr;
+}
+
+auto staging_ring::signaled(transfer const& t) const -> bool {
+	auto const& frame{frames[t.frame]};
+	if (frame.generation != t.generation || frame.fence == nullptr) {
+		return false;
+	}
+	auto const status{glClientWaitSync(frame.fence, 0, 0)};
+	return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+auto staging_ring::expired(transfer const& t) const -> bool {
+	return frames[t.frame].generation != t.generation;
+}
+
+auto staging_ring::finish(transfer const& t) -> bool {
+	if (expired(t)) {
+		return false;
+	}
+	if (t.frame == current) {
+		end_frame();
+	}
+	auto& frame{frames[t.frame]};
+	if (frame.fence == nullptr) {
+		return false;
+	}
+	auto status{glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait_timeout)};
+	while (status == GL_TIMEOUT_EXPIRED) {
+		status = glClientWaitSync(frame.fence, 0, wait_timeout);
+	}
+	return status != GL_WAIT_FAILED;
+}
+
+} // namespace gravity
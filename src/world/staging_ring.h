@@ -0,0 +1,118 @@
+#ifndef STAGING_RING_H
+#define STAGING_RING_H
+
+#include "opengl.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace gravity {
+
+class staging_ring;
+
+// An asynchronous copy through a staging_ring. Must not outlive its ring. A default
+// constructed transfer moved nothing and is always ready.
+class transfer {
+public:
+	// The GPU has finished the copy, never waits.
+	[[nodiscard]] auto ready() const -> bool;
+	// The ring reused the memory of a readback before its bytes were taken.
+	[[nodiscard]] auto expired() const -> bool;
+	// Blocks until the GPU has finished the copy, returns false if it expired.
+	auto wait() const -> bool;
+	// The bytes of a finished readback, empty until it is ready.
+	[[nodiscard]] auto data() const -> std::span<std::byte const>;
+
+	template <typename T>
+	[[nodiscard]] auto as() const -> std::span<T const> {
+		auto const bytes{data()};
+		return {reinterpret_cast<T const*>(bytes.data()), bytes.size() / sizeof(T)};
+	}
+
+private:
+	friend class staging_ring;
+
+	staging_ring* ring{nullptr};
+	size_t frame{0};
+	uint64_t generation{0};
+	size_t offset{0};
+	size_t size{0};
+};
+
+// One persistently mapped buffer split into frames_in_flight frames, each fenced when the
+// next one starts. CPU writes and GPU readbacks go through the frame being recorded while
+// the GPU still works on the earlier ones, a frame is only reused once its fence signals.
+// Frames grow to fit a transfer up to max_frame_size. Larger writes are copied in frame sized
+// chunks, a larger readback grows the ring until its frame is reused and then it shrinks back.
+// Readbacks in flight expire when the ring is reallocated.
+class staging_ring {
+public:
+	explicit staging_ring(size_t frames_in_flight = 3, size_t frame_size = size_t{4} << 20, size_t max_frame_size = size_t{64} << 20);
+	~staging_ring();
+	staging_ring(staging_ring const&) = delete;
+	auto operator=(staging_ring const&) -> staging_ring& = delete;
+	staging_ring(staging_ring&&) = delete;
+	auto operator=(staging_ring&&) -> staging_ring& = delete;
+
+	// Calls fill(bytes) with the staging memory for bytes_per_target bytes per target back to
+	// back, then copies them to target_offset in each target.
+	template <typename Fill>
+	auto write(std::span<GLuint const> targets, size_t target_offset, size_t bytes_per_target, Fill&& fill) -> transfer {
+		if (targets.empty() || bytes_per_target == 0) {
+			return {};
+		}
+		if (targets.size() * bytes_per_target > max_frame_size) {
+			// Filled on the heap once instead of growing the mapped memory for good.
+			auto scratch{std::vector<std::byte>(targets.size() * bytes_per_target)};
+			fill(std::span<std::byte>{scratch});
+			return write(targets, target_offset, scratch);
+		}
+		auto const staged{allocate(targets.size() * bytes_per_target)};
+		fill(std::span<std::byte>{mapped + staged.offset, staged.size});
+		copy_to(staged, targets, target_offset, bytes_per_target);
+		return staged;
+	}
+
+	// Copies bytes.size() / targets.size() bytes of bytes to target_offset in each target, in
+	// frame sized chunks if they do not fit in a frame. Ready once the last chunk is.
+	auto write(std::span<GLuint const> targets, size_t target_offset, std::span<std::byte const> bytes) -> transfer;
+
+	// Copies the first bytes_per_source bytes of every source back to back.
+	auto read(std::span<GLuint const> sources, size_t bytes_per_source) -> transfer;
+
+	// Fences everything recorded since the last call and starts the next frame, only waits
+	// if the GPU is frames_in_flight frames behind.
+	auto end_frame() -> void;
+
+private:
+	friend class transfer;
+
+	struct frame_state {
+		GLsync fence{nullptr};
+		uint64_t generation{0};
+		size_t used{0};
+	};
+
+	auto allocate(size_t bytes) -> transfer;
+	auto copy_to(transfer const& staged, std::span<GLuint const> targets, size_t target_offset, size_t bytes_per_target) -> void;
+	auto reallocate(size_t new_frame_size) -> void;
+	auto wait_for(frame_state& frame) -> void;
+	auto signaled(transfer const& t) const -> bool;
+	auto expired(transfer const& t) const -> bool;
+	auto finish(transfer const& t) -> bool;
+
+	GLuint buffer{0};
+	std::byte* mapped{nullptr};
+	size_t frame_size{0};
+	size_t max_frame_size;
+	// Frames until the ring shrinks back to max_frame_size after a large readback.
+	size_t frames_until_shrink{0};
+	std::vector<frame_state> frames;
+	size_t current{0};
+};
+
+} // namespace gravity
+
+#endif
@@ -1,57 +1,403 @@
 #include "world.h"
 
+#include "checkpoint.h"
+#include "initial_conditions.h"
 #include "components.h"
+#include "gl_resources.h"
+#include "gl_state.h"
+#include "program_cache.h"
 #include "gravity_system.h"
 #include "shape.h"
-
-#include "randomness.hpp"
+#include "spawn.h"
 
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <cmath>
 #include <filesystem>
 #include <fmt/core.h>
 #include <glm/gtx/norm.hpp>
 #include <imgui.h>
 #include <random>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
 #include <easy/profiler.h>
+#include <trace.h>
 
 namespace gravity {
 
-world::world()
+namespace {
+constexpr char const* velocity_pass{"VELOCITY SHADER"};
+
+// 20 flops per interaction as in GPU Gems 3 ch. 31, the defaults peaks are a GTX 1070 and one AVX2 core.
+constexpr auto gpu_cost{profiling::solver_cost{
+	.name = "GPU compute",
+	.flops_per_interaction = 20.0,
+	.bytes_per_interaction = sizeof(glm::vec4),
+	// Only the velocity pass is timed: its own position, and the velocity read and written back.
+	.bytes_per_body = 3 * sizeof(glm::vec4),
+	.peak_gflops = 6500.0,
+	.peak_bandwidth_gbs = 256.0,
+}};
+constexpr auto cpu_cost{profiling::solver_cost{
+	.name = "CPU brute force",
+	.flops_per_interaction = 20.0,
+	.bytes_per_interaction = sizeof(glm::vec3) + sizeof(glm::vec4),
+	.bytes_per_body = 4 * sizeof(glm::vec4),
+	.peak_gflops = 112.0,
+	.peak_bandwidth_gbs = 20.0,
+}};
+} // namespace
+
+world::world(std::optional<uint64_t> seed)
 	: gravity_compute_shader{compute{std::filesystem::path{"assets/shaders/gravity.glsl"}}}
 	, position_compute_shader{compute{std::filesystem::path{"assets/shaders/positions.glsl"}}}
-	, position_compute_handle{0}
-	, velocity_compute_handle{0}
-	, random_engine{r()}
+	, gpu_bodies{gravity_compute_shader}
+	, random_engine{static_cast<std::default_random_engine::result_type>(seed.value_or(r()))}
+	, spawn_seed{seed ? *seed : random_engine()}
+	, gpu_throughput{gpu_cost}
+	, cpu_throughput{cpu_cost}
 	{
 	registry.set<gravity_system::gravity_constant>(10.f);
-	
-	position_compute_handle = gravity_compute_shader.generate_buffer(100, 0, GL_DYNAMIC_COPY);
-	velocity_compute_handle = gravity_compute_shader.generate_buffer(100, 1, GL_DYNAMIC_COPY);
+	make_particle_group(registry);
 }
 
 auto world::tick(float delta_time) -> void {
 	EASY_FUNCTION();
+	if (replay) {
+		if (replay_playing && replay_frame + 1 < replay->size()) {
+			show_replay_frame(replay_frame + 1);
+		}
+		return;
+	}
+	simulation_time += delta_time;
+	++tick_count;
+	if (backend == simulation_backend::cpu_brute_force) {
+		tick_cpu(delta_time);
+		return;
+	}
 
+	auto const buffer_size{gpu_bodies.size()};
 	EASY_BLOCK("VELOCITY SHADER");
+	gpu_timer.begin(velocity_pass, buffer_size);
 	gravity_compute_shader.use();
 	gravity_compute_shader.upload_uniform("delta_time", delta_time);
 	gravity_compute_shader.upload_uniform("gravity_constant", registry.ctx<const gravity_system::gravity_constant>().value);
-	auto const buffer_size{registry.view<physics_component>().size()};
+	gravity_compute_shader.upload_uniform("body_count", static_cast<int>(buffer_size));
 	auto const workgroup_size{static_cast<unsigned int>(buffer_size / 32 + (buffer_size % 32 == 0 ? 0 : 1))};
 	gravity_compute_shader.dispatch(std::max(workgroup_size, 1u), 1, 1);
-
+	gpu_timer.end();
 	EASY_END_BLOCK;
 
 	EASY_BLOCK("POSITION SHADER");
+	gpu_timer.begin("POSITION SHADER");
 	position_compute_shader.use();
 	position_compute_shader.upload_uniform("delta_time", delta_time);
+	position_compute_shader.upload_uniform("body_count", static_cast<int>(buffer_size));
 	position_compute_shader.dispatch(std::max(workgroup_size, 1u), 1, 1);
+	gpu_timer.end();
 	EASY_END_BLOCK;
+	capture_trajectory(buffer_size);
+	TRACE_COUNTER("Bodies", buffer_size);
+}
+
+auto world::tick_cpu(float delta_time) -> void {
+	auto const body_count{static_cast<uint64_t>(registry.view<physics_component>().size())};
+	auto const solver_start{std::chrono::steady_clock::now()};
+	{
+		auto const stage{profiling::perf_scope{perf_counters, profiling::stage::force}};
+		gravity_system::accumulate_forces(registry, delta_time);
+	}
+	perf_counters.add_interactions(profiling::stage::force, body_count == 0 ? 0 : body_count * (body_count - 1));
+	{
+		auto const stage{profiling::perf_scope{perf_counters, profiling::stage::integration}};
+		gravity_system::integrate(registry, delta_time);
+	}
+	cpu_throughput.record_tick(body_count, std::chrono::duration<double>(std::chrono::steady_clock::now() - solver_start).count());
+	// The instanced renderer reads positions from the storage buffers.
+	auto const stage{profiling::perf_scope{perf_counters, profiling::stage::upload}};
+	if (trajectory && trajectory->wants(tick_count)) {
+		pack_particles(registry, staging);
+		gpu_bodies.update([this](std::span<glm::vec4> positions, std::span<glm::vec4> velocities) {
+			std::copy(staging.positions.begin(), staging.positions.end(), positions.begin());
+			std::copy(staging.velocities.begin(), staging.velocities.end(), velocities.begin());
+		});
+		trajectory->submit(tick_count, simulation_time, staging.positions, staging.velocities);
+	} else {
+		upload_registry();
+	}
+	TRACE_COUNTER("Bodies", body_count);
+}
+
+auto world::set_backend(simulation_backend new_backend) -> void {
+	if (new_backend == backend) {
+		return;
+	}
+	// The CPU solver continues from the state the compute shaders left in the buffers.
+	if (backend == simulation_backend::gpu_compute) {
+		download_particles();
+	}
+	backend = new_backend;
+	perf_counters.reset();
+}
+
+auto world::upload_particles(std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities) -> void {
+	gpu_bodies.assign(particle_entities(registry), positions, velocities);
+}
+
+auto world::upload_registry() -> void {
+	TRACE_FUNCTION();
+	gpu_bodies.update([this](std::span<glm::vec4> positions, std::span<glm::vec4> velocities) {
+		pack_particles(registry, positions, velocities);
+	});
+}
+
+auto world::download_particles() -> void {
+	auto const readback{gpu_bodies.read()};
+	if (!readback.wait()) {
+		fmt::print(stderr, "Failed to read the bodies back from the GPU\n");
+		return;
+	}
+	auto const bodies{readback.as<glm::vec4>()};
+	auto const count{static_cast<std::ptrdiff_t>(gpu_bodies.size())};
+	staging.positions.assign(bodies.begin(), bodies.begin() + count);
+	staging.velocities.assign(bodies.begin() + count, bodies.end());
+	unpack_particles(staging, registry);
+}
+
+auto world::attach_sphere(entt::entity entity, int resolution, float radius) -> void {
+	registry.emplace_or_replace<renderable>(entity, shape::create_sphere(resolution), radius);
+	registry.emplace_or_replace<sphere_component>(entity, resolution, radius);
+}
+
+auto world::remove_deleted_bodies() -> void {
+	auto deleted = registry.view<const deletion_component>();
+	if (deleted.empty()) {
+		return;
+	}
+	TRACE_FUNCTION();
+	// The table hands the slot to the last body first, the group does the same when the entity is destroyed.
+	auto const entities{std::vector<entt::entity>(deleted.begin(), deleted.end())};
+	for (auto const entity : entities) {
+		if (gpu_bodies.contains(entity)) {
+			gpu_bodies.remove(entity);
+		}
+		registry.destroy(entity);
+	}
+}
+
+auto world::save_checkpoint(std::filesystem::path const& path) -> void {
+	TRACE_FUNCTION();
+	if (backend == simulation_backend::gpu_compute) {
+		download_particles();
+	} else {
+		pack_particles(registry, staging);
+	}
+	auto rng_state{std::ostringstream{}};
+	rng_state << random_engine << ' ' << spawn_seed;
+	auto const state{io::simulation_state{
+		.gravity_constant = registry.ctx<const gravity_system::gravity_constant>().value,
+		.time = simulation_time,
+		.tick_count = tick_count,
+		.rng_state = rng_state.str(),
+	}};
+	io::save_checkpoint(path, registry, staging, state);
+	fmt::print("Saved {} bodies at tick {} to {}\n", staging.size(), tick_count, path.string());
+}
+
+auto world::load_checkpoint(std::filesystem::path const& path) -> void {
+	TRACE_FUNCTION();
+	auto const file{io::checkpoint{path}};
+	auto const state{file.state()};
+
+	// Throws before touching the registry, a failed load keeps the current bodies.
+	file.restore(registry);
+	replay.reset();
+	// The mapped arrays already have the storage buffer layout and the slot order of the registry.
+	upload_particles(file.positions(), file.velocities());
+	registry.set<gravity_system::gravity_constant>(state.gravity_constant);
+	for (auto [entity, sphere] : registry.view<const sphere_component>().each()) {
+		registry.emplace_or_replace<renderable>(entity, shape::create_sphere(sphere.resolution), sphere.radius);
+	}
+	simulation_time = state.time;
+	tick_count = state.tick_count;
+	auto rng_state{std::istringstream{state.rng_state}};
+	rng_state >> random_engine;
+	// Checkpoints written before the seed was stored keep the current one.
+	if (auto seed{uint64_t{0}}; rng_state >> seed) {
+		spawn_seed = seed;
+	}
+	perf_counters.reset();
+	fmt::print("Loaded {} bodies at tick {} from {}\n", file.positions().size(), tick_count, path.string());
+}
+
+auto world::load_initial_conditions(std::filesystem::path const& path) -> void {
+	TRACE_FUNCTION();
+	auto const start{std::chrono::steady_clock::now()};
+	auto const bodies{io::initial_conditions{path}};
+	replay.reset();
+
+	registry.clear();
+	create_particles(registry, bodies.positions(), bodies.velocities());
+	upload_particles(bodies.positions(), bodies.velocities());
+	simulation_time = 0.0;
+	tick_count = 0;
+	perf_counters.reset();
+	fmt::print("Loaded {} bodies from {} in {:.2f} s\n", bodies.positions().size(), path.string(), std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+auto world::record_trajectory(io::trajectory_options options) -> void {
+	trajectory = std::make_unique<io::trajectory_writer>(std::move(options));
+	trajectory_captures.clear();
+}
+
+auto world::capture_trajectory(uint64_t body_count) -> void {
+	if (!trajectory || !trajectory->wants(tick_count)) {
+		return;
+	}
+	auto const source_count{trajectory->needs_velocities() ? size_t{2} : size_t{1}};
+	auto bodies{gravity_compute_shader.read_async<glm::vec4>(gpu_bodies.buffers().first(source_count), body_count)};
+	trajectory_captures.push_back(trajectory_capture{tick_count, simulation_time, bodies});
+}
+
+auto world::collect_trajectory() -> void {
+	if (!trajectory) {
+		return;
+	}
+	// Captures that sat in the staging ring for too long were overwritten.
+	while (!trajectory_captures.empty()) {
+		auto const& capture{trajectory_captures.front()};
+		if (capture.bodies.expired()) {
+			trajectory->drop();
+		} else if (capture.bodies.ready()) {
+			auto const data{capture.bodies.as<glm::vec4>()};
+			auto const sources{trajectory->needs_velocities() ? size_t{2} : size_t{1}};
+			auto const bodies{data.size() / sources};
+			auto const velocities{sources == 2 ? data.subspan(bodies) : std::span<glm::vec4 const>{}};
+			trajectory->submit(capture.tick, capture.time, data.first(bodies), velocities);
+		} else {
+			return;
+		}
+		trajectory_captures.pop_front();
+	}
+}
+
+auto world::open_replay(std::filesystem::path const& path, io::timeline_options options) -> void {
+	TRACE_FUNCTION();
+	replay = std::make_unique<io::timeline>(path, options);
+	registry.clear();
+	gpu_bodies.clear();
+	replay_playing = false;
+	show_replay_frame(0);
+	fmt::print("Replaying {} frames from {}\n", replay->size(), path.string());
+}
+
+auto world::show_replay_frame(size_t frame) -> void {
+	try {
+		auto const decoded{replay->frame(frame)};
+		// Straight into the buffer instanced.vert reads, the registry holds no bodies while replaying.
+		gpu_bodies.reserve(decoded->positions.size());
+		gravity_compute_shader.write_async(std::span<glm::vec4 const>{decoded->positions}, gpu_bodies.positions());
+		replay_frame = frame;
+		replay_body_count = decoded->positions.size();
+		simulation_time = decoded->time;
+		tick_count = decoded->tick;
+	} catch (std::runtime_error const& error) {
+		fmt::print(stderr, "{}\n", error.what());
+		replay_playing = false;
+	}
+}
+
+auto world::show_replay_window() -> void {
+	if (!replay) {
+		return;
+	}
+	ImGui::Begin("Replay");
+	auto frame{static_cast<int>(replay_frame)};
+	if (ImGui::SliderInt("Frame", &frame, 0, static_cast<int>(replay->size()) - 1)) {
+		show_replay_frame(static_cast<size_t>(frame));
+	}
+	if (ImGui::Button(replay_playing ? "Pause" : "Play")) {
+		replay_playing = !replay_playing;
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("<") && replay_frame > 0) {
+		show_replay_frame(replay_frame - 1);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button(">") && replay_frame + 1 < replay->size()) {
+		show_replay_frame(replay_frame + 1);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Stop replay")) {
+		replay.reset();
+		ImGui::End();
+		return;
+	}
+	ImGui::Text("%zu bodies, %.1f MB cached", replay_body_count, static_cast<double>(replay->cached_bytes()) / 1e6);
+	ImGui::End();
+}
+
+auto world::show_stats_window() -> void {
+	ImGui::Begin("Stats");
+	for (auto* solver : {&gpu_throughput, &cpu_throughput}) {
+		if (solver->totals().ticks > 0) {
+			solver->show_stats();
+			ImGui::Separator();
+		}
+	}
+	perf_counters.show_stats();
+	auto const resources{gl::stats()};
+	ImGui::Separator();
+	ImGui::Text("GL objects: %zu buffers, %zu vertex arrays, %zu textures, %zu awaiting deletion", resources.buffers, resources.vertex_arrays, resources.textures, resources.pending);
+	auto const binds{gl::frame_state_stats()};
+	ImGui::Text("GL binds per frame: %zu issued, %zu skipped as redundant", binds.issued, binds.skipped);
+	auto const programs{gl::program_stats()};
+	ImGui::Text("Programs: %zu from the binary cache, %zu compiled, %.0f ms linking", programs.loaded, programs.compiled, programs.milliseconds);
+	ImGui::Text("Shared models: %zu", shape::cached_models());
+	if (trajectory) {
+		auto const stats{trajectory->stats()};
+		ImGui::Separator();
+		ImGui::Text("Trajectory: %llu frames, %.1f MB written, %llu dropped, %.1f MB queued",
+			static_cast<unsigned long long>(stats.frames_written),
+			static_cast<double>(stats.bytes_written) / 1e6,
+			static_cast<unsigned long long>(stats.frames_dropped),
+			static_cast<double>(stats.queued_bytes) / 1e6);
+		if (stats.codec.frames > 0) {
+			ImGui::Text("Compression: %.2fx at %.1f MB/s, %llu keyframes", stats.codec.ratio(), stats.codec.throughput_mbs(), static_cast<unsigned long long>(stats.codec.keyframes));
+		}
+		if (stats.disk_full) {
+			ImGui::Text("Disk budget reached, recording stopped");
+		}
+	}
+	if (ImGui::Button("Reset")) {
+		perf_counters.reset();
+	}
+	ImGui::End();
+}
+
+auto world::print_report(std::FILE* out) const -> void {
+	fmt::print(out, "Solver throughput:\n");
+	gpu_throughput.print_summary(out);
+	cpu_throughput.print_summary(out);
+	if (perf_counters.available()) {
+		fmt::print(out, "Hardware counters per stage:\n");
+		perf_counters.print_report(out);
+	}
 }
 
 auto world::update(float elapsed_time, float delta_time) -> void {
 	EASY_FUNCTION();
+	for (auto const& sample : gpu_timer.collect()) {
+		if (sample.name == velocity_pass) {
+			gpu_throughput.record_tick(sample.payload, sample.seconds);
+		}
+	}
+	gravity_compute_shader.end_transfer_frame();
+	collect_trajectory();
+	remove_deleted_bodies();
 	controller.update(elapsed_time, delta_time);
 	auto spheres = registry.view<sphere_component, renderable>();
 
@@ -60,11 +406,15 @@ auto world::update(float elapsed_time, float delta_time) -> void {
 	constexpr float max_gravity{10.f};
 	auto& g_c = registry.ctx<gravity_system::gravity_constant>();
 	ImGui::SliderFloat("Gravity Constant", &g_c.value, min_gravity, max_gravity, "%.3f", 1.f);
+	auto backend_index{static_cast<int>(backend)};
+	if (ImGui::Combo("Backend", &backend_index, "GPU compute\0CPU brute force\0")) {
+		set_backend(static_cast<simulation_backend>(backend_index));
+	}
 	if (ImGui::SliderScalar("Sphere resolution", ImGuiDataType_U8, &sphere_resolution, &shape::min_sphere_resolution, &shape::max_sphere_resolution)) {
 		for (auto&& [entity, sphere, renderable] : spheres.each()) {
 			auto const resolution{sphere_resolution};
 			if (sphere.resolution != resolution) {
-				shape::regenerate_sphere(renderable.model, resolution, sphere.radius);
+				renderable.model = shape::create_sphere(resolution);
 				sphere.resolution = resolution;
 			}
 		}
@@ -74,121 +424,124 @@ auto world::update(float elapsed_time, float delta_time) -> void {
 	ImGui::Begin("Spawn");
 	if (ImGui::Button("Spawn sphere")) {
 		auto const sphere_entity = registry.create();
-		registry.emplace_or_replace<physics_component>(sphere_entity, glm::vec3{0.0, 0.0, 0.0}, 1.f);
-		registry.emplace_or_replace<transform_component>(sphere_entity, controller.view_position(2.f));
-		auto const resolution{5};
-		auto sphere{shape::create_sphere(resolution, 0.5f)};
-		registry.emplace_or_replace<renderable>(sphere_entity, sphere);
+		auto const& physics{registry.emplace_or_replace<physics_component>(sphere_entity, glm::vec3{0.0, 0.0, 0.0}, 1.f)};
+		auto const& transform{registry.emplace_or_replace<transform_component>(sphere_entity, controller.view_position(2.f))};
+		gpu_bodies.append(std::array{sphere_entity}, std::array{glm::vec4{transform.position, physics.mass}}, std::array{glm::vec4{physics.velocity, 0.f}});
+		attach_sphere(sphere_entity, 5, 0.5f);
 		registry.emplace<name_component>(sphere_entity, "SPHERE");
-		registry.emplace_or_replace<sphere_component>(sphere_entity, resolution, 0.5f);
 	}
 
 	if (ImGui::Button("Spawn moon system")) {
-		position_compute_shader.use();
-		position_compute_shader.clear_buffer(position_compute_handle);
-		gravity_compute_shader.use();
-		gravity_compute_shader.clear_buffer(velocity_compute_handle);
-		registry.clear();
-
-		auto const planet = registry.create();
-		auto const moon = registry.create();
-		registry.emplace<name_component>(planet, "PLANET");
-		registry.emplace<name_component>(moon, "MOON");
-
-		auto const& planet_physics = registry.emplace<physics_component>(planet, glm::vec3{0.f}, 1000.f);
-		auto& moon_physics = registry.emplace<physics_component>(moon, glm::vec3{0.f}, 1.f);
-
-		registry.emplace<transform_component>(planet, glm::vec3{0.f});
-		auto& moon_transform = registry.emplace<transform_component>(moon, glm::vec3{10.f, 0.f, 0.f});
-
-		auto const init_velocity{
-			std::sqrt(registry.ctx<const gravity_system::gravity_constant>().value * (planet_physics.mass + 1 / moon_physics.mass) / moon_transform.position.x)};
-		moon_physics.velocity.z = init_velocity;
-
-		auto sphere{shape::create_sphere(15, 0.5f)};
-		registry.emplace_or_replace<renderable>(moon, sphere);
-		registry.emplace_or_replace<sphere_component>(moon, 15, 0.5f);
-		auto planet_sphere{shape::create_sphere(15, 5.f)};
-		registry.emplace_or_replace<renderable>(planet, planet_sphere);
-		registry.emplace_or_replace<sphere_component>(planet, 15, 5.f);
+		replay.reset();
+		auto const [planet, moon] = spawn::moon_system(registry);
+		attach_sphere(moon, 15, 0.5f);
+		attach_sphere(planet, 15, 5.f);
+		pack_particles(registry, staging);
+		upload_particles(staging.positions, staging.velocities);
 	}
+	ImGui::InputScalar("Seed", ImGuiDataType_U64, &spawn_seed);
 	ImGui::DragFloatRange2("Band", &asteroid_inner_radius, &asteroid_outer_radius);
 
 	if (ImGui::Button("Spawn Asteroids")) {
-		gravity_compute_shader.use();
-		gravity_compute_shader.clear_buffer(position_compute_handle);
-		gravity_compute_shader.use();
-		gravity_compute_shader.clear_buffer(velocity_compute_handle);
-		registry.clear();
-
-		auto const planet = registry.create();
-		auto& planet_physics = registry.emplace<physics_component>(planet, glm::vec3{0.f}, 1000.f);
-		registry.emplace<transform_component>(planet, glm::vec3{0.f});
-		auto planet_sphere{shape::create_sphere(15, 5.f)};
-		registry.emplace_or_replace<renderable>(planet, planet_sphere);
-		registry.emplace_or_replace<sphere_component>(planet, 15, 5.f);
-		registry.emplace<name_component>(planet, "PLANET");
-		
-		std::uniform_real_distribution<float> pos_dist(asteroid_inner_radius, asteroid_outer_radius);
-		for (size_t i{0}; i < asteroid_amount; ++i) {
-			auto const asteroid = registry.create();
-			auto& asteroid_physics = registry.emplace<physics_component>(asteroid, glm::vec3{0.f}, 0.01f);
-
-			auto const init_pos{random::generate_point_in_sphere(pos_dist, random_engine)};
-			
-			// auto& asteroid_transform = registry.emplace<transform_component>(asteroid, glm::vec3{pos_dist(el), 0.f, pos_dist(el)});
-			auto& asteroid_transform = registry.emplace<transform_component>(asteroid, init_pos);
-			auto const init_velocity_direction{glm::normalize(glm::cross(-asteroid_transform.position, glm::vec3{0.f, 1.f, 0.f}))};
-
-			auto const init_velocity{std::sqrt(
-				registry.ctx<const gravity_system::gravity_constant>().value * (planet_physics.mass + 1 / asteroid_physics.mass) / glm::length(asteroid_transform.position))};
-			asteroid_physics.velocity = init_velocity_direction * init_velocity;
-
-			registry.emplace<name_component>(asteroid, "ASTEROID");
-			registry.emplace<instanced_component>(asteroid);
-		}
-		std::vector<glm::vec4> velocity_buffer{};
-		auto physics = registry.view<const physics_component>();
-		std::transform(physics.begin(), physics.end(), std::back_inserter(velocity_buffer), 
-		[&registry = registry](entt::entity entity) {
-			auto const vel = registry.get<physics_component>(entity).velocity;
-			return glm::vec4{vel.x, vel.y, vel.z, 0.f};
-		});
-
-		auto position_view = registry.view<transform_component, physics_component>();
-		std::vector<glm::vec4> position_buffer{};
-		std::transform(position_view.begin(), position_view.end(), std::back_inserter(position_buffer), 
-		[&registry = registry](entt::entity entity) {
-			auto const pos = registry.get<transform_component>(entity).position;
-			auto const mass = registry.get<physics_component>(entity).mass;
-			return glm::vec4{pos.x, pos.y, pos.z, mass};
-		});
-
-		gravity_compute_shader.regenerate_buffer(velocity_buffer, velocity_compute_handle);
-		gravity_compute_shader.upload(velocity_buffer, velocity_compute_handle);
+		replay.reset();
+		// The next seed comes from the world engine, so a checkpoint restores the same sequence of scenes.
+		auto const belt{spawn::asteroid_belt{static_cast<size_t>(std::max(asteroid_amount, 0)), asteroid_inner_radius, asteroid_outer_radius, spawn_seed}};
+		auto const planet{spawn::asteroids(registry, belt, staging)};
+		attach_sphere(planet, 15, 5.f);
+		upload_particles(staging.positions, staging.velocities);
+		fmt::print("Spawned {} asteroids with seed {}\n", belt.amount, belt.seed);
+		spawn_seed = random_engine();
+	}
 
-		gravity_compute_shader.regenerate_buffer(position_buffer, position_compute_handle);
-		gravity_compute_shader.upload(position_buffer, position_compute_handle);
+	ImGui::InputInt("Asteroid amount", &asteroid_amount);
+	if (ImGui::Button("Remove asteroids")) {
+		auto removed{0};
+		for (auto const entity : registry.view<const instanced_component>(entt::exclude<deletion_component>)) {
+			if (removed++ == asteroid_amount) {
+				break;
+			}
+			registry.emplace<deletion_component>(entity);
+		}
+	}
 
+	ImGui::Separator();
+	auto model{static_cast<int>(galaxy_options.model)};
+	if (ImGui::Combo("Galaxy", &model, "Plummer sphere\0Hernquist halo\0Exponential disk\0")) {
+		galaxy_options.model = static_cast<spawn::galaxy_model>(model);
+	}
+	auto galaxy_amount{static_cast<int>(galaxy_options.amount)};
+	if (ImGui::InputInt("Galaxy bodies", &galaxy_amount)) {
+		galaxy_options.amount = static_cast<size_t>(std::max(galaxy_amount, 0));
+	}
+	ImGui::DragFloat("Galaxy mass", &galaxy_options.total_mass, 10.f, 0.f, 1e6f);
+	ImGui::DragFloat("Scale radius", &galaxy_options.scale_radius, 0.1f, 0.1f, 1000.f);
+	if (galaxy_options.model == spawn::galaxy_model::exponential_disk) {
+		ImGui::DragFloat("Scale height", &galaxy_options.scale_height, 0.01f, 0.f, 100.f);
+		ImGui::DragFloat("Central mass", &galaxy_options.central_mass, 10.f, 0.f, 1e6f);
+	}
+	if (ImGui::Button("Spawn galaxy")) {
+		replay.reset();
+		galaxy_options.seed = spawn_seed;
+		auto const center{spawn::galaxy_bodies(registry, galaxy_options, staging)};
+		if (center != entt::null) {
+			attach_sphere(center, 15, 5.f);
+		}
+		upload_particles(staging.positions, staging.velocities);
+		fmt::print("Spawned {} galaxy bodies with seed {}\n", galaxy_options.amount, galaxy_options.seed);
+		spawn_seed = random_engine();
 	}
 
-	ImGui::InputInt("Asteroid amount", &asteroid_amount);
+	ImGui::Separator();
+	ImGui::InputText("Checkpoint", checkpoint_path.data(), checkpoint_path.size());
+	auto const save{ImGui::Button("Save checkpoint")};
+	ImGui::SameLine();
+	auto const load{ImGui::Button("Load checkpoint")};
+	try {
+		if (save) {
+			save_checkpoint(checkpoint_path.data());
+		}
+		if (load) {
+			load_checkpoint(checkpoint_path.data());
+		}
+	} catch (std::runtime_error const& error) {
+		fmt::print(stderr, "{}\n", error.what());
+	}
+	ImGui::InputText("Bodies", bodies_path.data(), bodies_path.size());
+	if (ImGui::Button("Load bodies")) {
+		try {
+			load_initial_conditions(bodies_path.data());
+		} catch (std::runtime_error const& error) {
+			fmt::print(stderr, "{}\n", error.what());
+		}
+	}
+	ImGui::Text("Tick %llu, t = %.2f", static_cast<unsigned long long>(tick_count), simulation_time);
 
 	ImGui::End();
+	show_stats_window();
+	show_replay_window();
 };
 
 auto world::draw(renderer& renderer, float elapsed_time, float delta_time) const -> void {
 	EASY_FUNCTION();
+	(void)elapsed_time;
 	(void)delta_time;
-	// https://learnopengl.com/Advanced-OpenGL/Instancing
-	auto instanced_view = registry.view<const instanced_component>();
-	renderer.draw_asteroid_instanced(instanced_view.size());
-
+	// Queued first, removals move bodies with a model of their own between the asteroids and
+	// culling skips their slots.
 	auto view = registry.view<const transform_component, const renderable>(entt::exclude<instanced_component>);
-	renderer.start_non_instanced();
 	for (auto&& [entity, transform, renderable] : view.each()) {
-		renderer.draw_model(renderable.model, transform.position, elapsed_time, delta_time);
+		// Bodies follow the storage buffers, their transform is only current on the CPU backend.
+		auto const slot{gpu_bodies.contains(entity) ? static_cast<int32_t>(gpu_bodies.slot(entity)) : -1};
+		renderer.queue_model(*renderable.model, {.position = transform.position, .scale = renderable.scale, .slot = slot});
+	}
+
+	// https://learnopengl.com/Advanced-OpenGL/Instancing
+	{
+		auto const scope{profiling::gpu_scope{gpu_timer, "DRAW INSTANCED"}};
+		renderer.draw_asteroid_instanced(replay ? replay_body_count : gpu_bodies.size());
 	}
+
+	auto const scope{profiling::gpu_scope{gpu_timer, "DRAW MODELS"}};
+	renderer.draw_queued_models();
 }
 
 auto world::handle_event(SDL_Event const& e) -> void {
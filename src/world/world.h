@@ -1,25 +1,73 @@
 #ifndef WORLD_H
 #define WORLD_H
 
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <optional>
 #include <entt/entt.hpp>
 #include <SDL.h>
 #include <random>
+#include <span>
 
 #include "renderer.h"
+#include "spawn.h"
 #include "model.h"
+#include "body_table.h"
 #include "compute.h"
 #include "free_controller.h"
+#include "gpu_timer.h"
+#include "particles.h"
+#include "perf_counters.h"
+#include "throughput.h"
+#include "timeline.h"
+#include "trajectory_writer.h"
 
 namespace gravity {
 
+enum class simulation_backend : int {
+	gpu_compute,
+	cpu_brute_force,
+};
+
 class world {
 	compute gravity_compute_shader;
 	compute position_compute_shader;
-	unsigned int position_compute_handle;
-	unsigned int velocity_compute_handle;
+	body_table gpu_bodies;
 
 	std::random_device r;
 	std::default_random_engine random_engine;
+	// Seed of the next scene spawned, drawn from random_engine after each one.
+	uint64_t spawn_seed;
+
+	// Mutable so the const draw path can time its GPU work.
+	mutable profiling::gpu_timer gpu_timer;
+	profiling::perf_counters perf_counters{};
+	profiling::throughput gpu_throughput;
+	profiling::throughput cpu_throughput;
+
+	simulation_backend backend{simulation_backend::gpu_compute};
+	particle_buffers staging{};
+	double simulation_time{0.0};
+	uint64_t tick_count{0};
+
+	std::unique_ptr<io::trajectory_writer> trajectory{};
+	struct trajectory_capture {
+		uint64_t tick;
+		double time;
+		transfer bodies;
+	};
+	// Readbacks in flight, in request order.
+	std::deque<trajectory_capture> trajectory_captures{};
+
+	// Replaces the simulation while set, the instanced bodies are drawn from the current frame.
+	std::unique_ptr<io::timeline> replay{};
+	size_t replay_frame{0};
+	size_t replay_body_count{0};
+	bool replay_playing{false};
 
 	entt::registry registry;
 	glm::mat4 view{};
@@ -30,14 +78,48 @@ class world {
 	float asteroid_inner_radius{15.f};
 	float asteroid_outer_radius{25.f};	
 
+	spawn::galaxy galaxy_options{};
+
+	std::array<char, 256> checkpoint_path{"checkpoint.grav"};
+	std::array<char, 256> bodies_path{"bodies.csv"};
+
+	auto tick_cpu(float delta_time) -> void;
+	auto set_backend(simulation_backend new_backend) -> void;
+	// Replaces the bodies on the GPU, given in the slot order of the registry.
+	auto upload_particles(std::span<glm::vec4 const> positions, std::span<glm::vec4 const> velocities) -> void;
+	// Packs the registry straight into the staging memory of the storage buffers.
+	auto upload_registry() -> void;
+	auto download_particles() -> void;
+	// Destroys the entities tagged with deletion_component.
+	auto remove_deleted_bodies() -> void;
+	// Draws entity as a sphere with the shared model of that resolution.
+	auto attach_sphere(entt::entity entity, int resolution, float radius) -> void;
+	auto show_stats_window() -> void;
+	auto capture_trajectory(uint64_t body_count) -> void;
+	auto collect_trajectory() -> void;
+	auto show_replay_frame(size_t frame) -> void;
+	auto show_replay_window() -> void;
+
 public:
-	world();
+	// Scenes are seeded from seed if given, from std::random_device otherwise.
+	explicit world(std::optional<uint64_t> seed = std::nullopt);
 	~world() = default;
 
 	auto tick(float delta_time) -> void;
 	auto update(float elapsed_time, float delta_time) -> void;
 	auto draw(renderer& renderer,  float elapsed_time, float delta_time) const -> void;
 	auto handle_event(SDL_Event const& event) -> void;
+	// Both throw std::runtime_error, loading replaces every body.
+	auto save_checkpoint(std::filesystem::path const& path) -> void;
+	auto load_checkpoint(std::filesystem::path const& path) -> void;
+	// Replaces every body with the ones in a CSV or binary body file, throws std::runtime_error.
+	auto load_initial_conditions(std::filesystem::path const& path) -> void;
+	// Streams bodies to a trajectory file from now on, throws std::runtime_error.
+	auto record_trajectory(io::trajectory_options options) -> void;
+	// Plays back a trajectory file instead of simulating, throws std::runtime_error.
+	auto open_replay(std::filesystem::path const& path, io::timeline_options options) -> void;
+	// End of run summary.
+	auto print_report(std::FILE* out) const -> void;
 	free_controller controller{};
 };
 
@@ -0,0 +1,103 @@
+#include "body_table.h"
+#include "check.h"
+#include "compute.h"
+#include "gl_mock.h"
+#include "particles.h"
+
+#include <cstddef>
+#include <cstring>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+namespace {
+
+using namespace gravity;
+using gravity::test::check;
+
+auto make_bodies(size_t count, float first) -> particle_buffers {
+	auto bodies{particle_buffers{}};
+	for (size_t i{0}; i < count; ++i) {
+		auto const f{first + static_cast<float>(i)};
+		bodies.positions.emplace_back(f, -f, 2.f * f, 1.f + f);
+		bodies.velocities.emplace_back(0.5f * f, f, -f, 0.f);
+	}
+	return bodies;
+}
+
+// Every body of the group has the slot of its group index, and the storage buffers hold its
+// position and velocity there.
+auto consistent(entt::registry& registry, body_table const& table) -> bool {
+	auto const entities{particle_entities(registry)};
+	if (table.size() != entities.size() || table.capacity() < table.size()) {
+		return false;
+	}
+	auto packed{particle_buffers{}};
+	pack_particles(registry, packed);
+	auto const positions{test::buffer_bytes(table.positions())};
+	auto const velocities{test::buffer_bytes(table.velocities())};
+	auto const bytes{entities.size() * sizeof(glm::vec4)};
+	for (size_t slot{0}; slot < entities.size(); ++slot) {
+		if (!table.contains(entities[slot]) || table.slot(entities[slot]) != slot) {
+			return false;
+		}
+	}
+	return positions.size() >= bytes && velocities.size() >= bytes && std::memcmp(positions.data(), packed.positions.data(), bytes) == 0
+		&& std::memcmp(velocities.data(), packed.velocities.data(), bytes) == 0;
+}
+
+auto add_bodies(entt::registry& registry, body_table& table, particle_buffers const& bodies) -> std::vector<entt::entity> {
+	auto const entities{create_particles(registry, bodies.positions, bodies.velocities)};
+	table.append(entities, bodies.positions, bodies.velocities);
+	return entities;
+}
+
+auto remove_body(entt::registry& registry, body_table& table, entt::entity entity) -> void {
+	// The order of world::remove_deleted_bodies.
+	table.remove(entity);
+	registry.destroy(entity);
+}
+
+} // namespace
+
+auto main() -> int {
+	test::install_gl_mock();
+	auto transfers{compute{GLuint{1}}};
+	auto registry{entt::registry{}};
+	make_particle_group(registry);
+	auto table{body_table{transfers, 4}};
+
+	auto const scene{make_bodies(3, 0.f)};
+	auto const first{create_particles(registry, scene.positions, scene.velocities)};
+	table.assign(particle_entities(registry), scene.positions, scene.velocities);
+	check(consistent(registry, table), "assign follows the group");
+
+	// Past the initial capacity twice.
+	auto const added{add_bodies(registry, table, make_bodies(10, 100.f))};
+	check(table.capacity() >= 13, "grows to fit");
+	check(consistent(registry, table), "grow keeps every slot");
+
+	remove_body(registry, table, first[0]);
+	check(!table.contains(first[0]), "removed body has no slot");
+	check(consistent(registry, table), "swap-remove of the first slot");
+	remove_body(registry, table, added[4]);
+	check(consistent(registry, table), "swap-remove of a middle slot");
+	remove_body(registry, table, particle_entities(registry).back());
+	check(consistent(registry, table), "swap-remove of the last slot");
+
+	// Destroyed ids are recycled with a new version, the old handles must not match them.
+	auto const recycled{add_bodies(registry, table, make_bodies(20, 200.f))};
+	check(!table.contains(first[0]), "recycled id does not revive the removed handle");
+	check(consistent(registry, table), "append after removes");
+
+	for (size_t i{0}; i < recycled.size(); i += 2) {
+		remove_body(registry, table, recycled[i]);
+	}
+	check(consistent(registry, table), "every other body removed");
+
+	table.clear();
+	registry.clear();
+	check(table.size() == 0 && particle_entities(registry).empty(), "clear empties both");
+	return gravity::test::result();
+}
@@ -0,0 +1,31 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <fmt/core.h>
+#include <source_location>
+#include <string_view>
+
+namespace gravity::test {
+
+inline int failures{0};
+
+// Records a failure instead of aborting, so one run reports every broken check.
+inline auto check(bool condition, std::string_view what, std::source_location location = std::source_location::current()) -> bool {
+	if (!condition) {
+		++failures;
+		fmt::print(stderr, "{}:{}: check failed: {}\n", location.file_name(), location.line(), what);
+	}
+	return condition;
+}
+
+inline auto result() -> int {
+	if (failures != 0) {
+		fmt::print(stderr, "{} checks failed\n", failures);
+		return 1;
+	}
+	return 0;
+}
+
+} // namespace gravity::test
+
+#endif
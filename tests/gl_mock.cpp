@@ -0,0 +1,155 @@
+#include "gl_mock.h"
+
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace gravity::test {
+
+namespace {
+
+struct mock_buffer {
+	std::vector<std::byte> bytes{};
+	GLenum usage{GL_STATIC_DRAW};
+	bool mapped{false};
+};
+
+std::map<GLuint, mock_buffer> buffers{};
+std::map<GLenum, GLuint> bound{};
+GLuint next_name{1};
+uintptr_t next_fence{1};
+
+auto target(GLenum binding) -> mock_buffer& {
+	auto const found{buffers.find(bound[binding])};
+	if (found == buffers.end()) {
+		throw std::runtime_error{"No buffer bound"};
+	}
+	return found->second;
+}
+
+auto APIENTRY gen_buffers(GLsizei count, GLuint* names) -> void {
+	for (GLsizei i{0}; i < count; ++i) {
+		names[i] = next_name++;
+		buffers[names[i]] = mock_buffer{};
+	}
+}
+
+auto APIENTRY delete_buffers(GLsizei count, GLuint const* names) -> void {
+	for (GLsizei i{0}; i < count; ++i) {
+		buffers.erase(names[i]);
+	}
+}
+
+auto APIENTRY bind_buffer(GLenum binding, GLuint buffer) -> void {
+	bound[binding] = buffer;
+}
+
+auto APIENTRY bind_buffer_base(GLenum binding, GLuint, GLuint buffer) -> void {
+	bound[binding] = buffer;
+}
+
+auto APIENTRY buffer_data(GLenum binding, GLsizeiptr size, void const* data, GLenum usage) -> void {
+	auto& buffer{target(binding)};
+	buffer.bytes.assign(static_cast<size_t>(size), std::byte{0});
+	buffer.usage = usage;
+	if (data != nullptr) {
+		std::memcpy(buffer.bytes.data(), data, static_cast<size_t>(size));
+	}
+}
+
+auto APIENTRY buffer_storage(GLenum binding, GLsizeiptr size, void const* data, GLbitfield) -> void {
+	buffer_data(binding, size, data, GL_DYNAMIC_DRAW);
+}
+
+auto APIENTRY buffer_sub_data(GLenum binding, GLintptr offset, GLsizeiptr size, void const* data) -> void {
+	auto& buffer{target(binding)};
+	if (static_cast<size_t>(offset + size) > buffer.bytes.size()) {
+		throw std::runtime_error{"glBufferSubData out of range"};
+	}
+	std::memcpy(buffer.bytes.data() + offset, data, static_cast<size_t>(size));
+}
+
+auto APIENTRY get_buffer_sub_data(GLenum binding, GLintptr offset, GLsizeiptr size, void* data) -> void {
+	std::memcpy(data, target(binding).bytes.data() + offset, static_cast<size_t>(size));
+}
+
+auto APIENTRY get_buffer_parameteriv(GLenum binding, GLenum name, GLint* value) -> void {
+	auto const& buffer{target(binding)};
+	*value = name == GL_BUFFER_SIZE ? static_cast<GLint>(buffer.bytes.size()) : static_cast<GLint>(buffer.usage);
+}
+
+auto APIENTRY map_buffer_range(GLenum binding, GLintptr offset, GLsizeiptr, GLbitfield) -> void* {
+	auto& buffer{target(binding)};
+	buffer.mapped = true;
+	return buffer.bytes.data() + offset;
+}
+
+auto APIENTRY unmap_buffer(GLenum binding) -> GLboolean {
+	target(binding).mapped = false;
+	return GL_TRUE;
+}
+
+auto APIENTRY copy_buffer_sub_data(GLenum read, GLenum write, GLintptr read_offset, GLintptr write_offset, GLsizeiptr size) -> void {
+	auto const& source{target(read)};
+	auto& destination{target(write)};
+	if (static_cast<size_t>(read_offset + size) > source.bytes.size() || static_cast<size_t>(write_offset + size) > destination.bytes.size()) {
+		throw std::runtime_error{"glCopyBufferSubData out of range"};
+	}
+	std::memmove(destination.bytes.data() + write_offset, source.bytes.data() + read_offset, static_cast<size_t>(size));
+}
+
+auto APIENTRY fence_sync(GLenum, GLbitfield) -> GLsync {
+	return reinterpret_cast<GLsync>(next_fence++);
+}
+
+auto APIENTRY client_wait_sync(GLsync, GLbitfield, GLuint64) -> GLenum {
+	return GL_ALREADY_SIGNALED;
+}
+
+auto APIENTRY delete_sync(GLsync) -> void {}
+auto APIENTRY memory_barrier(GLbitfield) -> void {}
+auto APIENTRY use_program(GLuint) -> void {}
+auto APIENTRY delete_program(GLuint) -> void {}
+
+auto APIENTRY is_program(GLuint program) -> GLboolean {
+	return program != 0 ? GL_TRUE : GL_FALSE;
+}
+
+} // namespace
+
+auto install_gl_mock() -> void {
+	glGenBuffers = gen_buffers;
+	glDeleteBuffers = delete_buffers;
+	glBindBuffer = bind_buffer;
+	glBindBufferBase = bind_buffer_base;
+	glBufferData = buffer_data;
+	glBufferStorage = buffer_storage;
+	glBufferSubData = buffer_sub_data;
+	glGetBufferSubData = get_buffer_sub_data;
+	glGetBufferParameteriv = get_buffer_parameteriv;
+	glMapBufferRange = map_buffer_range;
+	glUnmapBuffer = unmap_buffer;
+	glCopyBufferSubData = copy_buffer_sub_data;
+	glFenceSync = fence_sync;
+	glClientWaitSync = client_wait_sync;
+	glDeleteSync = delete_sync;
+	glMemoryBarrier = memory_barrier;
+	glUseProgram = use_program;
+	glDeleteProgram = delete_program;
+	glIsProgram = is_program;
+}
+
+auto buffer_bytes(GLuint buffer) -> std::span<std::byte const> {
+	return buffers.at(buffer).bytes;
+}
+
+auto mapped_bytes() -> size_t {
+	auto total{size_t{0}};
+	for (auto const& [name, buffer] : buffers) {
+		total += buffer.mapped ? buffer.bytes.size() : 0;
+	}
+	return total;
+}
+
+} // namespace gravity::test
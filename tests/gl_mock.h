@@ -0,0 +1,21 @@
+#ifndef GL_MOCK_H
+#define GL_MOCK_H
+
+#include "opengl.h"
+
+#include <cstddef>
+#include <span>
+
+namespace gravity::test {
+
+// Points the GLEW entry points the buffer code uses at an in-memory imitation, so it runs
+// without a context. Commands execute immediately and every fence is signaled.
+auto install_gl_mock() -> void;
+
+// Bytes of a buffer created through the mock.
+[[nodiscard]] auto buffer_bytes(GLuint buffer) -> std::span<std::byte const>;
+[[nodiscard]] auto mapped_bytes() -> size_t;
+
+} // namespace gravity::test
+
+#endif
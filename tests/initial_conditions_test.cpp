@@ -0,0 +1,124 @@
+#include "check.h"
+#include "initial_conditions.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <glm/glm.hpp>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace gravity;
+using gravity::test::check;
+
+auto directory() -> std::filesystem::path {
+	return std::filesystem::temp_directory_path() / "gravity_initial_conditions_test";
+}
+
+auto write_file(std::string_view name, std::string_view text) -> std::filesystem::path {
+	auto const path{directory() / name};
+	std::ofstream file{path, std::ios::binary | std::ios::trunc};
+	file.write(text.data(), static_cast<std::streamsize>(text.size()));
+	return path;
+}
+
+auto equal(glm::vec4 const& a, glm::vec4 const& b) -> bool {
+	return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+}
+
+auto throws(std::function<void()> const& load) -> bool {
+	try {
+		load();
+	} catch (std::runtime_error const&) {
+		return true;
+	}
+	return false;
+}
+
+auto positions_only() -> void {
+	auto const bodies{io::initial_conditions{write_file("positions.csv", "1 2 3\n-4.5,5e2,+6\n")}};
+	check(bodies.positions().size() == 2, "one body per row");
+	check(equal(bodies.positions()[1], glm::vec4{-4.5f, 500.f, 6.f, 1.f}), "positions parsed, mass defaults to one");
+	check(equal(bodies.velocities()[0], glm::vec4{0.f, 0.f, 0.f, 0.f}), "velocities default to zero");
+}
+
+auto reordered_header() -> void {
+	auto const bodies{io::initial_conditions{write_file("reordered.csv", "mass,id,vz,vy,vx,z,y,x\n2,17,6,5,4,3,2,1\n")}};
+	check(bodies.positions().size() == 1, "header line is not a body");
+	check(equal(bodies.positions()[0], glm::vec4{1.f, 2.f, 3.f, 2.f}), "positions and mass follow the header");
+	check(equal(bodies.velocities()[0], glm::vec4{4.f, 5.f, 6.f, 0.f}), "velocities follow the header");
+}
+
+auto comments() -> void {
+	auto const text{"# generated\n\n  # indented comment\nx y z m\r\n1 2 3 4\r\n# between rows\n\n5 6 7 8\r\n   \n"};
+	auto const bodies{io::initial_conditions{write_file("comments.csv", text)}};
+	check(bodies.positions().size() == 2, "comments and blank lines are skipped");
+	check(equal(bodies.positions()[0], glm::vec4{1.f, 2.f, 3.f, 4.f}), "first row after the header");
+	check(equal(bodies.positions()[1], glm::vec4{5.f, 6.f, 7.f, 8.f}), "row after a comment");
+}
+
+auto malformed_rows() -> void {
+	check(throws([] { io::initial_conditions{write_file("letters.csv", "1 2 3\n1 two 3\n")}; }), "non-numeric field throws");
+	check(throws([] { io::initial_conditions{write_file("short.csv", "1 2 3\n1 2\n")}; }), "row with fewer than three fields throws");
+	check(throws([] { io::initial_conditions{write_file("suffix.csv", "1 2 3x\n")}; }), "trailing garbage throws");
+	check(throws([] { io::initial_conditions{write_file("no_z.csv", "x,y,mass\n1,2,3\n")}; }), "header without z throws");
+}
+
+auto binary_round_trip() -> void {
+	auto positions{std::vector<glm::vec4>{}};
+	auto velocities{std::vector<glm::vec4>{}};
+	for (size_t i{0}; i < 100; ++i) {
+		auto const f{static_cast<float>(i)};
+		positions.emplace_back(f, -f, f * 0.5f, f + 1.f);
+		velocities.emplace_back(f * 0.25f, f * 2.f, -f, 0.f);
+	}
+	auto const path{directory() / "bodies.bin"};
+	io::save_bodies(path, positions, velocities);
+	auto const bodies{io::initial_conditions{path}};
+	auto same{bodies.positions().size() == positions.size() && bodies.velocities().size() == velocities.size()};
+	for (size_t i{0}; same && i < positions.size(); ++i) {
+		same = equal(bodies.positions()[i], positions[i]) && equal(bodies.velocities()[i], velocities[i]);
+	}
+	check(same, "binary bodies load as saved");
+
+	check(throws([&] { io::save_bodies(path, positions, std::span{velocities}.first(10)); }), "mismatched arrays are not saved");
+
+	// A body_count that would wrap around when multiplied by the vec4 size.
+	auto corrupt{std::vector<char>{}};
+	{
+		std::ifstream file{path, std::ios::binary};
+		corrupt.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+	}
+	auto const huge{uint64_t{1} << 60};
+	std::memcpy(corrupt.data() + offsetof(io::body_file_header, body_count), &huge, sizeof(huge));
+	auto const corrupt_path{write_file("corrupt.bin", {corrupt.data(), corrupt.size()})};
+	check(throws([&] { io::initial_conditions{corrupt_path}; }), "oversized body_count throws");
+
+	auto const misaligned{uint64_t{sizeof(io::body_file_header) + 1}};
+	auto const count{uint64_t{1}};
+	std::memcpy(corrupt.data() + offsetof(io::body_file_header, body_count), &count, sizeof(count));
+	std::memcpy(corrupt.data() + offsetof(io::body_file_header, positions_offset), &misaligned, sizeof(misaligned));
+	auto const misaligned_path{write_file("misaligned.bin", {corrupt.data(), corrupt.size()})};
+	check(throws([&] { io::initial_conditions{misaligned_path}; }), "misaligned positions throw");
+}
+
+} // namespace
+
+auto main() -> int {
+	std::filesystem::create_directories(directory());
+	positions_only();
+	reordered_header();
+	comments();
+	malformed_rows();
+	binary_round_trip();
+	std::filesystem::remove_all(directory());
+	return gravity::test::result();
+}
@@ -0,0 +1,155 @@
+#include "check.h"
+#include "trajectory_codec.h"
+#include "trajectory_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fmt/core.h>
+#include <glm/glm.hpp>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+using namespace gravity;
+using gravity::test::check;
+
+constexpr size_t body_count{1000};
+constexpr size_t frame_count{70};
+
+struct frame {
+	std::vector<glm::vec4> positions{};
+	std::vector<glm::vec4> velocities{};
+};
+
+// Bodies drifting along their velocities, so delta frames have small but nonzero residuals.
+auto make_frames() -> std::vector<frame> {
+	auto engine{std::mt19937{1337}};
+	auto coordinate{std::uniform_real_distribution<float>{-100.f, 100.f}};
+	auto speed{std::uniform_real_distribution<float>{-1.f, 1.f}};
+	auto mass{std::uniform_real_distribution<float>{0.1f, 10.f}};
+	auto frames{std::vector<frame>(frame_count)};
+	for (size_t i{0}; i < body_count; ++i) {
+		frames[0].positions.emplace_back(coordinate(engine), coordinate(engine), coordinate(engine), mass(engine));
+		frames[0].velocities.emplace_back(speed(engine), speed(engine), speed(engine), 0.f);
+	}
+	for (size_t f{1}; f < frame_count; ++f) {
+		frames[f] = frames[f - 1];
+		for (size_t i{0}; i < body_count; ++i) {
+			for (int c{0}; c < 3; ++c) {
+				frames[f].positions[i][c] += frames[f].velocities[i][c] * 0.1f;
+				frames[f].velocities[i][c] *= 0.99f;
+			}
+		}
+	}
+	return frames;
+}
+
+auto largest_extent(std::vector<glm::vec4> const& values) -> float {
+	auto extent{0.f};
+	for (int c{0}; c < 3; ++c) {
+		auto const [low, high] = std::minmax_element(values.begin(), values.end(), [c](auto const& a, auto const& b) { return a[c] < b[c]; });
+		extent = std::max(extent, (*high)[c] - (*low)[c]);
+	}
+	return extent;
+}
+
+// Every component within the error bound of the grid it was quantized on, plus float rounding.
+auto within_bound(std::vector<glm::vec4> const& expected, std::vector<glm::vec4> const& decoded, float bound) -> bool {
+	if (expected.size() != decoded.size()) {
+		return false;
+	}
+	for (size_t i{0}; i < expected.size(); ++i) {
+		for (int c{0}; c < 3; ++c) {
+			if (std::abs(expected[i][c] - decoded[i][c]) > bound + std::abs(expected[i][c]) * 1e-6f) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+auto round_trip(uint32_t fields) -> void {
+	fmt::print("fields {:#x}\n", fields);
+	auto const options{io::codec_options{.relative_error = 1e-5, .keyframe_interval = 32, .chunk_bodies = 256}};
+	auto const frames{make_frames()};
+	auto encoder{io::frame_encoder{options, fields}};
+	auto decoder{io::frame_decoder{}};
+	auto keyframe{size_t{0}};
+	auto positions{std::vector<glm::vec4>{}};
+	auto velocities{std::vector<glm::vec4>{}};
+	for (size_t f{0}; f < frame_count; ++f) {
+		auto encoded{std::vector<std::byte>{}};
+		encoder.encode(frames[f].positions, frames[f].velocities, encoded);
+		auto const is_keyframe{io::frame_decoder::is_keyframe(encoded)};
+		check(is_keyframe == (f % options.keyframe_interval == 0), "keyframe every keyframe_interval frames");
+		if (is_keyframe) {
+			keyframe = f;
+		}
+		decoder.decode(encoded, positions, velocities);
+
+		// Delta frames are quantized on the grid of their keyframe.
+		auto const position_bound{static_cast<float>(options.relative_error) * largest_extent(frames[keyframe].positions)};
+		auto const velocity_bound{static_cast<float>(options.relative_error) * largest_extent(frames[keyframe].velocities)};
+		check(positions.size() == body_count, "one position per body");
+		if ((fields & io::trajectory_field::positions) != 0) {
+			check(within_bound(frames[f].positions, positions, position_bound), "positions within relative_error");
+		} else {
+			check(std::all_of(positions.begin(), positions.end(), [](auto const& p) { return p.x == 0.f && p.y == 0.f && p.z == 0.f; }),
+				"positions left zero");
+		}
+		if ((fields & io::trajectory_field::velocities) != 0) {
+			check(within_bound(frames[f].velocities, velocities, velocity_bound), "velocities within relative_error");
+		} else {
+			check(velocities.empty(), "velocities left empty");
+		}
+		auto masses_match{true};
+		for (size_t i{0}; i < body_count; ++i) {
+			auto const expected{(fields & io::trajectory_field::masses) != 0 ? frames[f].positions[i].w : 0.f};
+			masses_match = masses_match && positions[i].w == expected;
+		}
+		check(masses_match, "masses exact or left zero");
+	}
+	check(encoder.stats().frames == frame_count, "every frame counted");
+	check(encoder.stats().keyframes == (frame_count + options.keyframe_interval - 1) / options.keyframe_interval, "every keyframe counted");
+}
+
+auto delta_without_keyframe() -> void {
+	auto const frames{make_frames()};
+	auto encoder{io::frame_encoder{io::codec_options{}, io::trajectory_field::positions}};
+	auto encoded{std::vector<std::byte>{}};
+	encoder.encode(frames[0].positions, {}, encoded);
+	encoded.clear();
+	encoder.encode(frames[1].positions, {}, encoded);
+
+	auto decoder{io::frame_decoder{}};
+	auto positions{std::vector<glm::vec4>{}};
+	auto velocities{std::vector<glm::vec4>{}};
+	auto threw{false};
+	try {
+		decoder.decode(encoded, positions, velocities);
+	} catch (std::runtime_error const&) {
+		threw = true;
+	}
+	check(threw, "delta frame without its keyframe throws");
+}
+
+} // namespace
+
+auto main() -> int {
+	using io::trajectory_field;
+	for (auto const fields : std::array<uint32_t, 4>{
+			 trajectory_field::positions,
+			 trajectory_field::positions | trajectory_field::velocities,
+			 trajectory_field::positions | trajectory_field::masses,
+			 trajectory_field::positions | trajectory_field::velocities | trajectory_field::masses,
+		 }) {
+		round_trip(fields);
+	}
+	delta_without_keyframe();
+	return gravity::test::result();
+}
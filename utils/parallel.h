@@ -0,0 +1,39 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace gravity {
+
+// Calls task(i) for every i in [0, count) on up to hardware_concurrency threads, the calling
+// thread takes part. Tasks must not throw.
+template <typename Task>
+auto parallel_for(size_t count, Task&& task) -> void {
+	auto const workers{std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()))};
+	if (workers <= 1) {
+		for (size_t i{0}; i < count; ++i) {
+			task(i);
+		}
+		return;
+	}
+	auto next{std::atomic<size_t>{0}};
+	auto const work = [&] {
+		for (auto i{next++}; i < count; i = next++) {
+			task(i);
+		}
+	};
+	auto threads{std::vector<std::jthread>{}};
+	threads.reserve(workers - 1);
+	for (size_t i{1}; i < workers; ++i) {
+		threads.emplace_back(work);
+	}
+	work();
+}
+
+} // namespace gravity
+
+#endif
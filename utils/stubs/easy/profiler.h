@@ -1,9 +1,13 @@
 #ifndef EASY_PROFILER_H
 #define EASY_PROFILER_H
 
-#define EASY_END_BLOCK
-#define EASY_BLOCK(name, ...)
-# define EASY_FUNCTION(...)
+// Maps the easy_profiler macros onto the built-in tracer when building without USE_PROFILER.
+#include <trace.h>
+
+// Blocks are normal level zones, see TRACE_LEVEL.
+#define EASY_END_BLOCK TRACE_END_SCOPE()
+#define EASY_BLOCK(name, ...) TRACE_SCOPE(name);
+#define EASY_FUNCTION(...) TRACE_FUNCTION();
 
 namespace profiler {
     inline void startListen() { }
@@ -0,0 +1,286 @@
+#include "trace.h"
+
+#include "trace_writer.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <fmt/core.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gravity::trace {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+} // namespace detail
+
+namespace {
+
+using trace_clock = std::chrono::steady_clock;
+
+constexpr size_t buffer_capacity{size_t{1} << 16};
+constexpr auto flush_interval{std::chrono::milliseconds{20}};
+
+// Single producer (the owning thread), single consumer (the flush thread) ring.
+struct thread_buffer {
+	std::array<event, buffer_capacity> events{};
+	std::atomic<uint64_t> head{0};
+	std::atomic<uint64_t> tail{0};
+	std::atomic<uint64_t> dropped{0};
+	// Set by the owning thread as it exits, the buffer is freed once drained.
+	std::atomic<bool> exited{false};
+	thread_info info{};
+
+	auto push(event const& e) -> void {
+		auto const h{head.load(std::memory_order_relaxed)};
+		if (h - tail.load(std::memory_order_acquire) >= buffer_capacity) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		events[h & (buffer_capacity - 1)] = e;
+		head.store(h + 1, std::memory_order_release);
+	}
+
+	template <typename F>
+	auto drain(F&& consume) -> void {
+		auto const h{head.load(std::memory_order_acquire)};
+		auto t{tail.load(std::memory_order_relaxed)};
+		for (; t != h; ++t) {
+			consume(events[t & (buffer_capacity - 1)]);
+		}
+		tail.store(t, std::memory_order_release);
+	}
+};
+
+struct tracer {
+	trace_clock::time_point const epoch{trace_clock::now()};
+
+	std::mutex buffers_mutex{};
+	std::vector<std::shared_ptr<thread_buffer>> buffers{};
+	std::vector<track_info> tracks{};
+	size_t written_tracks{0};
+	uint32_t next_tid{1};
+	// Of the buffers already freed.
+	uint64_t freed_dropped{0};
+
+	std::mutex flush_mutex{};
+	std::condition_variable flush_condition{};
+	bool stopping{false};
+	std::thread flush_thread{};
+	std::unique_ptr<writer> output{};
+
+	// Finishes the trace when main returns without trace::stop(), a joinable thread would terminate.
+	~tracer() {
+		stop();
+	}
+
+	auto flush() -> void {
+		auto pending{std::vector<std::shared_ptr<thread_buffer>>{}};
+		{
+			auto const lock{std::scoped_lock{buffers_mutex}};
+			pending = buffers;
+			for (; written_tracks < tracks.size(); ++written_tracks) {
+				output->write_track(tracks[written_tracks]);
+			}
+		}
+		for (auto const& buffer : pending) {
+			buffer->drain([this, &buffer](event const& e) { output->write(buffer->info, e); });
+		}
+		// parallel_for starts new threads on every call, their buffers would otherwise pile up.
+		auto const lock{std::scoped_lock{buffers_mutex}};
+		std::erase_if(buffers, [this](auto const& buffer) {
+			auto const drained{buffer->exited.load(std::memory_order_acquire)
+				&& buffer->head.load(std::memory_order_acquire) == buffer->tail.load(std::memory_order_relaxed)};
+			if (drained) {
+				freed_dropped += buffer->dropped.load(std::memory_order_relaxed);
+			}
+			return drained;
+		});
+	}
+
+	auto run() -> void {
+		auto lock{std::unique_lock{flush_mutex}};
+		while (!stopping) {
+			flush_condition.wait_for(lock, flush_interval, [this] { return stopping; });
+			lock.unlock();
+			flush();
+			lock.lock();
+		}
+	}
+
+	auto stop() -> void {
+		if (!flush_thread.joinable()) {
+			return;
+		}
+		detail::enabled.store(false, std::memory_order_relaxed);
+		{
+			auto const lock{std::scoped_lock{flush_mutex}};
+			stopping = true;
+		}
+		flush_condition.notify_one();
+		flush_thread.join();
+		flush();
+		output->finish();
+
+		auto dropped{uint64_t{0}};
+		{
+			auto const lock{std::scoped_lock{buffers_mutex}};
+			dropped = freed_dropped;
+			for (auto const& buffer : buffers) {
+				dropped += buffer->dropped.load(std::memory_order_relaxed);
+			}
+		}
+		if (dropped > 0) {
+			fmt::print(stderr, "Trace dropped {} events, the ring buffers were full\n", dropped);
+		}
+		output.reset();
+	}
+};
+
+auto instance() -> tracer& {
+	static tracer t{};
+	return t;
+}
+
+thread_local char const* current_thread_name{nullptr};
+thread_local thread_buffer* current_buffer{nullptr};
+thread_local uint32_t open_scopes{0};
+
+// Marks the buffer of its thread as exited when the thread ends.
+struct buffer_owner {
+	std::shared_ptr<thread_buffer> buffer{};
+
+	~buffer_owner() {
+		if (buffer) {
+			buffer->exited.store(true, std::memory_order_release);
+		}
+	}
+};
+
+thread_local buffer_owner owned_buffer{};
+
+auto local_buffer() -> thread_buffer& {
+	if (current_buffer == nullptr) {
+		auto& t{instance()};
+		auto buffer{std::make_shared<thread_buffer>()};
+		auto const lock{std::scoped_lock{t.buffers_mutex}};
+		buffer->info.tid = t.next_tid++;
+		buffer->info.name = current_thread_name != nullptr ? current_thread_name : fmt::format("thread {}", buffer->info.tid);
+		current_buffer = buffer.get();
+		owned_buffer.buffer = buffer;
+		t.buffers.push_back(std::move(buffer));
+	}
+	return *current_buffer;
+}
+
+} // namespace
+
+auto detail::record(event const& e) -> void {
+	local_buffer().push(e);
+}
+
+auto start(std::filesystem::path const& path) -> bool {
+	return start(path, path.extension() == ".json" ? format::chrome_json : format::perfetto);
+}
+
+auto start(std::filesystem::path const& path, format output_format) -> bool {
+	auto& t{instance()};
+	if (t.flush_thread.joinable()) {
+		fmt::print(stderr, "Tracing is already running\n");
+		return false;
+	}
+	t.output = writer::create(path, output_format);
+	if (t.output == nullptr) {
+		return false;
+	}
+	t.stopping = false;
+	t.written_tracks = 0;
+	t.flush_thread = std::thread{[&t] { t.run(); }};
+	detail::enabled.store(true, std::memory_order_relaxed);
+	fmt::print("Tracing to {}\n", path.string());
+	return true;
+}
+
+auto stop() -> void {
+	instance().stop();
+}
+
+auto now() noexcept -> uint64_t {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(trace_clock::now() - instance().epoch).count());
+}
+
+auto set_thread_name(char const* name) -> void {
+	current_thread_name = name;
+}
+
+auto register_track(char const* name) -> track_id {
+	auto& t{instance()};
+	auto const lock{std::scoped_lock{t.buffers_mutex}};
+	auto const id{static_cast<track_id>(t.tracks.size() + 1)};
+	t.tracks.push_back(track_info{id, name});
+	return id;
+}
+
+auto begin(char const* name) -> void {
+	++open_scopes;
+	auto e{event{}};
+	e.name = name;
+	e.timestamp = now();
+	e.track = thread_track;
+	e.type = event_type::begin;
+	detail::record(e);
+}
+
+auto end() -> void {
+	if (open_scopes == 0) {
+		return;
+	}
+	--open_scopes;
+	auto e{event{}};
+	e.name = nullptr;
+	e.timestamp = now();
+	e.track = thread_track;
+	e.type = event_type::end;
+	detail::record(e);
+}
+
+auto counter(char const* name, double value) -> void {
+	auto e{event{}};
+	e.name = name;
+	e.timestamp = now();
+	e.value = value;
+	e.track = thread_track;
+	e.type = event_type::counter;
+	detail::record(e);
+}
+
+auto complete(track_id track, char const* name, uint64_t begin_timestamp, uint64_t end_timestamp) -> void {
+	auto e{event{}};
+	e.name = name;
+	e.timestamp = begin_timestamp;
+	e.end_timestamp = end_timestamp;
+	e.track = track;
+	e.type = event_type::complete;
+	detail::record(e);
+}
+
+scope::scope(char const* name) {
+	if (!enabled()) {
+		return;
+	}
+	active = true;
+	depth = open_scopes;
+	trace::begin(name);
+}
+
+scope::~scope() {
+	// The scope may already have been closed by an explicit end().
+	if (active && open_scopes > depth) {
+		trace::end();
+	}
+}
+
+} // namespace gravity::trace
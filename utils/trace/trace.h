@@ -0,0 +1,188 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+
+// Built-in low overhead tracer. Every thread records scope begin/end events into
+// its own ring buffer and a background thread drains them into a Chrome trace
+// (.json) or Perfetto (.pftrace) file. Event names must be string literals, only
+// the pointer is recorded.
+namespace gravity::trace {
+
+enum class format {
+	chrome_json,
+	perfetto,
+};
+
+enum class event_type : uint8_t {
+	begin,
+	end,
+	complete,
+	counter,
+};
+
+struct event {
+	char const* name;
+	uint64_t timestamp;
+	// End timestamp for complete events, value for counters.
+	union {
+		uint64_t end_timestamp;
+		double value;
+	};
+	uint32_t track;
+	event_type type;
+};
+
+// Track 0 is the thread that recorded the event, other tracks are created with
+// register_track and are used for timelines that are not CPU threads, e.g. the GPU.
+using track_id = uint32_t;
+constexpr track_id thread_track{0};
+
+namespace detail {
+extern std::atomic<bool> enabled;
+auto record(event const& e) -> void;
+} // namespace detail
+
+[[nodiscard]] inline auto enabled() noexcept -> bool {
+	return detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Format is deduced from the extension, .json writes a Chrome trace and anything else Perfetto protobuf.
+auto start(std::filesystem::path const& path) -> bool;
+auto start(std::filesystem::path const& path, format output_format) -> bool;
+auto stop() -> void;
+
+// Nanoseconds since the tracer epoch.
+[[nodiscard]] auto now() noexcept -> uint64_t;
+
+// Must be called before the thread records its first event.
+auto set_thread_name(char const* name) -> void;
+[[nodiscard]] auto register_track(char const* name) -> track_id;
+
+auto begin(char const* name) -> void;
+// Ends the innermost open scope on this thread.
+auto end() -> void;
+auto counter(char const* name, double value) -> void;
+auto complete(track_id track, char const* name, uint64_t begin_timestamp, uint64_t end_timestamp) -> void;
+
+class scope {
+public:
+	explicit scope(char const* name);
+	~scope();
+	scope(scope const&) = delete;
+	auto operator=(scope const&) -> scope& = delete;
+	scope(scope&&) = delete;
+	auto operator=(scope&&) -> scope& = delete;
+
+private:
+	uint32_t depth{0};
+	bool active{false};
+};
+
+// Per thread state of a fine grained zone, only every period-th pass is recorded.
+struct sampled_site {
+	char const* name;
+	uint32_t period;
+	uint32_t countdown{1};
+	uint64_t hits{0};
+};
+
+class sampled_scope {
+public:
+	explicit sampled_scope(sampled_site& site)
+		: site{site} {
+		if (!enabled()) {
+			return;
+		}
+		++site.hits;
+		if (--site.countdown != 0) {
+			return;
+		}
+		site.countdown = site.period;
+		active = true;
+		trace::begin(site.name);
+	}
+	~sampled_scope() {
+		if (active) {
+			trace::end();
+			// The skipped passes only show up in the aggregate counter.
+			trace::counter(site.name, static_cast<double>(site.hits));
+		}
+	}
+	sampled_scope(sampled_scope const&) = delete;
+	auto operator=(sampled_scope const&) -> sampled_scope& = delete;
+	sampled_scope(sampled_scope&&) = delete;
+	auto operator=(sampled_scope&&) -> sampled_scope& = delete;
+
+private:
+	sampled_site& site;
+	bool active{false};
+};
+
+} // namespace gravity::trace
+
+// Instrumentation level selected at compile time with TRACE_LEVEL, zones above it compile to nothing.
+#define TRACE_LEVEL_OFF    0
+#define TRACE_LEVEL_COARSE 1
+#define TRACE_LEVEL_NORMAL 2
+#define TRACE_LEVEL_FINE   3
+
+#ifndef GRAVITY_TRACE_LEVEL
+#define GRAVITY_TRACE_LEVEL TRACE_LEVEL_NORMAL
+#endif
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b)      TRACE_CONCAT_IMPL(a, b)
+
+#ifdef EASY_PROFILER
+// USE_PROFILER builds hand the zones to easy_profiler, which does not sample: fine zones record every pass.
+#include <easy/profiler.h>
+#define TRACE_SCOPE_IMPL(name)                 EASY_BLOCK(name)
+#define TRACE_FUNCTION_IMPL()                  EASY_FUNCTION()
+#define TRACE_END_SCOPE_IMPL()                 EASY_END_BLOCK
+#define TRACE_SAMPLED_SCOPE_IMPL(name, period) EASY_BLOCK(name)
+#else
+#define TRACE_SCOPE_IMPL(name) ::gravity::trace::scope TRACE_CONCAT(trace_scope_, __COUNTER__){name}
+#define TRACE_FUNCTION_IMPL()  TRACE_SCOPE_IMPL(__func__)
+#define TRACE_END_SCOPE_IMPL() ::gravity::trace::end()
+#define TRACE_SAMPLED_SCOPE_IMPL(name, period) TRACE_SAMPLED_SCOPE_ID(name, period, __COUNTER__)
+#define TRACE_SAMPLED_SCOPE_ID(name, period, id) \
+	static thread_local ::gravity::trace::sampled_site TRACE_CONCAT(trace_site_, id){name, period}; \
+	::gravity::trace::sampled_scope TRACE_CONCAT(trace_sampled_scope_, id){TRACE_CONCAT(trace_site_, id)}
+#endif
+#define TRACE_DISABLED() static_cast<void>(0)
+
+#if GRAVITY_TRACE_LEVEL >= TRACE_LEVEL_COARSE
+#define TRACE_SCOPE_COARSE(name) TRACE_SCOPE_IMPL(name)
+#define TRACE_COUNTER(name, value) \
+	do { \
+		if (::gravity::trace::enabled()) { \
+			::gravity::trace::counter(name, static_cast<double>(value)); \
+		} \
+	} while (false)
+#else
+#define TRACE_SCOPE_COARSE(name)   TRACE_DISABLED()
+#define TRACE_COUNTER(name, value) TRACE_DISABLED()
+#endif
+
+#if GRAVITY_TRACE_LEVEL >= TRACE_LEVEL_NORMAL
+#define TRACE_SCOPE(name) TRACE_SCOPE_IMPL(name)
+#define TRACE_FUNCTION()  TRACE_FUNCTION_IMPL()
+// Ends the innermost TRACE_SCOPE early.
+#define TRACE_END_SCOPE() TRACE_END_SCOPE_IMPL()
+#else
+#define TRACE_SCOPE(name) TRACE_DISABLED()
+#define TRACE_FUNCTION()  TRACE_DISABLED()
+#define TRACE_END_SCOPE() TRACE_DISABLED()
+#endif
+
+// Fine zones are meant for hot loops, only every period-th pass is recorded.
+#if GRAVITY_TRACE_LEVEL >= TRACE_LEVEL_FINE
+#define TRACE_SCOPE_FINE(name, period) TRACE_SAMPLED_SCOPE_IMPL(name, period)
+#else
+#define TRACE_SCOPE_FINE(name, period) TRACE_DISABLED()
+#endif
+
+#endif
@@ -0,0 +1,317 @@
+#include "trace_writer.h"
+
+#include <cstring>
+#include <fmt/format.h>
+#include <string_view>
+
+namespace gravity::trace {
+
+namespace {
+
+constexpr uint32_t process_id{1};
+// Tracks that are not threads are shown as pseudo threads with ids above this.
+constexpr uint32_t track_tid_offset{100000};
+
+auto escape(std::string_view text) -> std::string {
+	auto escaped{std::string{}};
+	escaped.reserve(text.size());
+	for (auto const c : text) {
+		if (c == '"' || c == '\\') {
+			escaped.push_back('\\');
+		}
+		escaped.push_back(c);
+	}
+	return escaped;
+}
+
+// Minimal protobuf wire format encoding.
+namespace proto {
+enum wire_type : uint32_t {
+	varint = 0,
+	fixed64 = 1,
+	length_delimited = 2,
+};
+
+auto put_varint(std::vector<uint8_t>& out, uint64_t value) -> void {
+	while (value >= 0x80) {
+		out.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+auto put_tag(std::vector<uint8_t>& out, uint32_t field, wire_type type) -> void {
+	put_varint(out, (static_cast<uint64_t>(field) << 3) | type);
+}
+
+auto put_uint(std::vector<uint8_t>& out, uint32_t field, uint64_t value) -> void {
+	put_tag(out, field, varint);
+	put_varint(out, value);
+}
+
+auto put_double(std::vector<uint8_t>& out, uint32_t field, double value) -> void {
+	put_tag(out, field, fixed64);
+	uint8_t bytes[sizeof(double)];
+	std::memcpy(bytes, &value, sizeof(double));
+	out.insert(out.end(), std::begin(bytes), std::end(bytes));
+}
+
+auto put_string(std::vector<uint8_t>& out, uint32_t field, std::string_view value) -> void {
+	put_tag(out, field, length_delimited);
+	put_varint(out, value.size());
+	out.insert(out.end(), value.begin(), value.end());
+}
+
+auto put_message(std::vector<uint8_t>& out, uint32_t field, std::vector<uint8_t> const& message) -> void {
+	put_tag(out, field, length_delimited);
+	put_varint(out, message.size());
+	out.insert(out.end(), message.begin(), message.end());
+}
+} // namespace proto
+
+// Field numbers from perfetto/protos/perfetto/trace/trace_packet.proto and track_event/*.proto
+namespace field {
+constexpr uint32_t trace_packet{1};
+
+constexpr uint32_t packet_timestamp{8};
+constexpr uint32_t packet_sequence_id{10};
+constexpr uint32_t packet_track_event{11};
+constexpr uint32_t packet_sequence_flags{13};
+constexpr uint32_t packet_track_descriptor{60};
+
+constexpr uint32_t descriptor_uuid{1};
+constexpr uint32_t descriptor_name{2};
+constexpr uint32_t descriptor_process{3};
+constexpr uint32_t descriptor_thread{4};
+constexpr uint32_t descriptor_counter{8};
+
+constexpr uint32_t process_pid{1};
+constexpr uint32_t process_name{6};
+
+constexpr uint32_t thread_pid{1};
+constexpr uint32_t thread_tid{2};
+constexpr uint32_t thread_name{5};
+
+constexpr uint32_t event_type{9};
+constexpr uint32_t event_track_uuid{11};
+constexpr uint32_t event_name{23};
+constexpr uint32_t event_double_counter_value{44};
+} // namespace field
+
+enum track_event_type : uint64_t {
+	slice_begin = 1,
+	slice_end = 2,
+	counter_value = 4,
+};
+
+constexpr uint64_t sequence_id{1};
+constexpr uint64_t incremental_state_cleared{1};
+constexpr uint64_t process_uuid{0xffffffff};
+constexpr uint64_t track_uuid_offset{0x100000000};
+
+} // namespace
+
+writer::writer(std::FILE* file)
+	: file{file} {}
+
+writer::~writer() {
+	if (file != nullptr) {
+		std::fclose(file);
+	}
+}
+
+auto writer::create(std::filesystem::path const& path, format output_format) -> std::unique_ptr<writer> {
+	auto* const file{std::fopen(path.string().c_str(), "wb")};
+	if (file == nullptr) {
+		fmt::print(stderr, "Failed to open trace file {}\n", path.string());
+		return nullptr;
+	}
+	switch (output_format) {
+		case format::chrome_json: return std::make_unique<chrome_json_writer>(file);
+		case format::perfetto: return std::make_unique<perfetto_writer>(file);
+	}
+	return nullptr;
+}
+
+chrome_json_writer::chrome_json_writer(std::FILE* file)
+	: writer{file} {
+	fmt::print(file, "{{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	fmt::print(file, "{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":{},\"args\":{{\"name\":\"gravity\"}}}}", process_id);
+	first = false;
+}
+
+auto chrome_json_writer::separator() -> char const* {
+	if (first) {
+		first = false;
+		return "";
+	}
+	return ",\n";
+}
+
+auto chrome_json_writer::write_thread_name(thread_info const& thread) -> void {
+	if (named_threads.contains(thread.tid)) {
+		return;
+	}
+	named_threads[thread.tid] = true;
+	fmt::print(file,
+		"{}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+		separator(),
+		process_id,
+		thread.tid,
+		escape(thread.name));
+}
+
+auto chrome_json_writer::write(thread_info const& thread, event const& e) -> void {
+	write_thread_name(thread);
+	auto const tid{e.track == thread_track ? thread.tid : track_tid_offset + e.track};
+	auto const timestamp{static_cast<double>(e.timestamp) / 1000.0};
+	switch (e.type) {
+		case event_type::begin:
+			fmt::print(file, "{}{{\"name\":\"{}\",\"ph\":\"B\",\"ts\":{:.3f},\"pid\":{},\"tid\":{}}}", separator(), escape(e.name), timestamp, process_id, tid);
+			break;
+		case event_type::end: fmt::print(file, "{}{{\"ph\":\"E\",\"ts\":{:.3f},\"pid\":{},\"tid\":{}}}", separator(), timestamp, process_id, tid); break;
+		case event_type::complete: {
+			auto const duration{static_cast<double>(e.end_timestamp - e.timestamp) / 1000.0};
+			fmt::print(file,
+				"{}{{\"name\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":{},\"tid\":{}}}",
+				separator(),
+				escape(e.name),
+				timestamp,
+				duration,
+				process_id,
+				tid);
+			break;
+		}
+		case event_type::counter:
+			fmt::print(file, "{}{{\"name\":\"{}\",\"ph\":\"C\",\"ts\":{:.3f},\"pid\":{},\"args\":{{\"value\":{}}}}}", separator(), escape(e.name), timestamp, process_id, e.value);
+			break;
+	}
+}
+
+auto chrome_json_writer::write_track(track_info const& track) -> void {
+	fmt::print(file,
+		"{}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+		separator(),
+		process_id,
+		track_tid_offset + track.id,
+		escape(track.name));
+}
+
+auto chrome_json_writer::finish() -> void {
+	fmt::print(file, "\n]}}\n");
+	std::fflush(file);
+}
+
+perfetto_writer::perfetto_writer(std::FILE* file)
+	: writer{file} {
+	auto process{std::vector<uint8_t>{}};
+	proto::put_uint(process, field::process_pid, process_id);
+	proto::put_string(process, field::process_name, "gravity");
+
+	auto descriptor{std::vector<uint8_t>{}};
+	proto::put_uint(descriptor, field::descriptor_uuid, process_uuid);
+	proto::put_message(descriptor, field::descriptor_process, process);
+
+	auto packet{std::vector<uint8_t>{}};
+	proto::put_uint(packet, field::packet_sequence_id, sequence_id);
+	proto::put_uint(packet, field::packet_sequence_flags, incremental_state_cleared);
+	proto::put_message(packet, field::packet_track_descriptor, descriptor);
+	write_packet(packet);
+}
+
+auto perfetto_writer::write_packet(std::vector<uint8_t> const& packet) -> void {
+	auto framed{std::vector<uint8_t>{}};
+	framed.reserve(packet.size() + 8);
+	proto::put_message(framed, field::trace_packet, packet);
+	std::fwrite(framed.data(), 1, framed.size(), file);
+}
+
+auto perfetto_writer::thread_uuid(thread_info const& thread) -> uint64_t {
+	if (auto const found{thread_uuids.find(thread.tid)}; found != thread_uuids.end()) {
+		return found->second;
+	}
+	auto const uuid{next_uuid++};
+	thread_uuids[thread.tid] = uuid;
+
+	auto descriptor_thread{std::vector<uint8_t>{}};
+	proto::put_uint(descriptor_thread, field::thread_pid, process_id);
+	proto::put_uint(descriptor_thread, field::thread_tid, thread.tid);
+	proto::put_string(descriptor_thread, field::thread_name, thread.name);
+
+	auto descriptor{std::vector<uint8_t>{}};
+	proto::put_uint(descriptor, field::descriptor_uuid, uuid);
+	proto::put_message(descriptor, field::descriptor_thread, descriptor_thread);
+
+	auto packet{std::vector<uint8_t>{}};
+	proto::put_uint(packet, field::packet_sequence_id, sequence_id);
+	proto::put_message(packet, field::packet_track_descriptor, descriptor);
+	write_packet(packet);
+	return uuid;
+}
+
+auto perfetto_writer::counter_uuid(char const* name) -> uint64_t {
+	if (auto const found{counter_uuids.find(name)}; found != counter_uuids.end()) {
+		return found->second;
+	}
+	auto const uuid{next_uuid++};
+	counter_uuids[name] = uuid;
+
+	auto descriptor{std::vector<uint8_t>{}};
+	proto::put_uint(descriptor, field::descriptor_uuid, uuid);
+	proto::put_string(descriptor, field::descriptor_name, name);
+	proto::put_message(descriptor, field::descriptor_counter, {});
+
+	auto packet{std::vector<uint8_t>{}};
+	proto::put_uint(packet, field::packet_sequence_id, sequence_id);
+	proto::put_message(packet, field::packet_track_descriptor, descriptor);
+	write_packet(packet);
+	return uuid;
+}
+
+auto perfetto_writer::write(thread_info const& thread, event const& e) -> void {
+	auto const slice_track{e.track == thread_track ? thread_uuid(thread) : track_uuid_offset + e.track};
+	auto const write_event = [this](uint64_t timestamp, uint64_t type, uint64_t track, char const* name, double const* value) {
+		auto track_event{std::vector<uint8_t>{}};
+		proto::put_uint(track_event, field::event_type, type);
+		proto::put_uint(track_event, field::event_track_uuid, track);
+		if (name != nullptr) {
+			proto::put_string(track_event, field::event_name, name);
+		}
+		if (value != nullptr) {
+			proto::put_double(track_event, field::event_double_counter_value, *value);
+		}
+
+		auto packet{std::vector<uint8_t>{}};
+		proto::put_uint(packet, field::packet_timestamp, timestamp);
+		proto::put_uint(packet, field::packet_sequence_id, sequence_id);
+		proto::put_message(packet, field::packet_track_event, track_event);
+		write_packet(packet);
+	};
+
+	switch (e.type) {
+		case event_type::begin: write_event(e.timestamp, slice_begin, slice_track, e.name, nullptr); break;
+		case event_type::end: write_event(e.timestamp, slice_end, slice_track, nullptr, nullptr); break;
+		case event_type::complete:
+			write_event(e.timestamp, slice_begin, slice_track, e.name, nullptr);
+			write_event(e.end_timestamp, slice_end, slice_track, nullptr, nullptr);
+			break;
+		case event_type::counter: write_event(e.timestamp, counter_value, counter_uuid(e.name), nullptr, &e.value); break;
+	}
+}
+
+auto perfetto_writer::write_track(track_info const& track) -> void {
+	auto descriptor{std::vector<uint8_t>{}};
+	proto::put_uint(descriptor, field::descriptor_uuid, track_uuid_offset + track.id);
+	proto::put_string(descriptor, field::descriptor_name, track.name);
+
+	auto packet{std::vector<uint8_t>{}};
+	proto::put_uint(packet, field::packet_sequence_id, sequence_id);
+	proto::put_message(packet, field::packet_track_descriptor, descriptor);
+	write_packet(packet);
+}
+
+auto perfetto_writer::finish() -> void {
+	std::fflush(file);
+}
+
+} // namespace gravity::trace
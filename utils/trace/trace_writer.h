@@ -0,0 +1,83 @@
+#ifndef TRACE_WRITER_H
+#define TRACE_WRITER_H
+
+#include "trace.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gravity::trace {
+
+struct thread_info {
+	uint32_t tid;
+	std::string name;
+};
+
+struct track_info {
+	track_id id;
+	std::string name;
+};
+
+// Serializes drained events. Only ever used from the flush thread.
+class writer {
+public:
+	writer(writer const&) = delete;
+	auto operator=(writer const&) -> writer& = delete;
+	writer(writer&&) = delete;
+	auto operator=(writer&&) -> writer& = delete;
+	virtual ~writer();
+
+	[[nodiscard]] static auto create(std::filesystem::path const& path, format output_format) -> std::unique_ptr<writer>;
+
+	virtual auto write(thread_info const& thread, event const& e) -> void = 0;
+	virtual auto write_track(track_info const& track) -> void = 0;
+	virtual auto finish() -> void = 0;
+
+protected:
+	explicit writer(std::FILE* file);
+	std::FILE* file;
+};
+
+class chrome_json_writer final : public writer {
+public:
+	explicit chrome_json_writer(std::FILE* file);
+
+	auto write(thread_info const& thread, event const& e) -> void override;
+	auto write_track(track_info const& track) -> void override;
+	auto finish() -> void override;
+
+private:
+	auto separator() -> char const*;
+	auto write_thread_name(thread_info const& thread) -> void;
+
+	std::unordered_map<uint32_t, bool> named_threads{};
+	bool first{true};
+};
+
+// Writes the protobuf encoding of perfetto.protos.Trace with TrackEvent packets, without interning.
+class perfetto_writer final : public writer {
+public:
+	explicit perfetto_writer(std::FILE* file);
+
+	auto write(thread_info const& thread, event const& e) -> void override;
+	auto write_track(track_info const& track) -> void override;
+	auto finish() -> void override;
+
+private:
+	auto thread_uuid(thread_info const& thread) -> uint64_t;
+	auto counter_uuid(char const* name) -> uint64_t;
+	auto write_packet(std::vector<uint8_t> const& packet) -> void;
+
+	std::unordered_map<uint32_t, uint64_t> thread_uuids{};
+	std::unordered_map<std::string, uint64_t> counter_uuids{};
+	uint64_t next_uuid{1};
+};
+
+} // namespace gravity::trace
+
+#endif